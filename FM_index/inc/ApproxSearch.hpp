@@ -0,0 +1,51 @@
+#ifndef APPROX_SEARCH_H
+#define APPROX_SEARCH_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include "FM_Index.hpp"
+
+enum class ErrorModel { Mismatch, Edit };
+
+struct ApproxOptions {
+	// differences allowed, at most 2
+	int max_diffs = 1;
+	// substitutions only, or substitutions plus single-base insertions/deletions
+	ErrorModel model = ErrorModel::Mismatch;
+	// backward-search steps one query may spend before it gives up
+	size_t work_budget = 100000;
+};
+
+// rows matching the pattern with `diffs` differences
+struct ApproxHit {
+	SAInterval range;
+	int diffs;
+};
+
+// Backtracking search over the BWT of T, right to left like exact search,
+// trying every base at each step. D[i], the number of differences p[0..i]
+// needs at least, comes from an exact forward scan over the index of the
+// reversed text and prunes a branch as soon as its remaining budget is below it.
+class ApproxSearcher {
+public:
+	// reverse must index T reversed, see FMIndex::buildReverse()
+	ApproxSearcher(const FMIndex& forward, const FMIndex& reverse) : fwd(forward), rev(reverse) {
+		if (fwd.rankBackend() != RankBackend::Dna || rev.rankBackend() != RankBackend::Dna) {
+			throw std::invalid_argument("Approximate search needs the DNA rank backend. ");
+		}
+	}
+
+	// hits sorted by range, each range reported once with its fewest diffs;
+	// returns false if the work budget ran out, hits found so far are kept
+	bool search(std::string_view pattern, const ApproxOptions& opt, std::vector<ApproxHit>& hits) const;
+
+private:
+	// lower bound on the differences of every pattern prefix
+	void lowerBounds(std::string_view pattern, std::vector<int>& D) const;
+
+	const FMIndex& fwd;
+	const FMIndex& rev;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef BI_FM_INDEX_H
+#define BI_FM_INDEX_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include "FM_Index.hpp"
+
+// rows of a pattern P in the forward index and of P reversed in the reverse
+// index, both ranges have the same size
+struct BiInterval {
+	SAInterval fwd;
+	int rev_sp;
+	int size() const { return fwd.size(); }
+	bool empty() const { return fwd.empty(); }
+	SAInterval rev() const { return {rev_sp, rev_sp + fwd.ep - fwd.sp}; }
+};
+
+// super-maximal exact match: read[begin, end) occurs in the text at the rows
+// of range, cannot be extended either way, and lies in no longer such match
+struct SMEM {
+	int begin, end;
+	SAInterval range;
+	int length() const { return end - begin; }
+};
+
+// FMIndex over T plus one over T reversed, searched together so a pattern
+// can grow at either end: growing one side is a rank step in its own index,
+// and the other index's range shrinks to the sub-range of the rows whose
+// next symbol is c, found by counting the smaller symbols in the current range.
+class BiFMIndex {
+public:
+	BiFMIndex() { }
+	// the reverse index only serves counting, its options are not used
+	explicit BiFMIndex(const std::string& T, const FMIndexOptions& opt = FMIndexOptions());
+
+	const FMIndex& forward() const { return fwd; }
+	const FMIndex& reverse() const { return rev; }
+
+	BiInterval all() const { return {fwd.all(), 0}; }
+	// P -> cP and P -> Pc, c an A/C/G/T code
+	BiInterval extendLeft(const BiInterval& range, int c) const;
+	BiInterval extendRight(const BiInterval& range, int c) const;
+
+	// SMEMs of read at least min_len long, sorted by begin; N in the read
+	// ends every match running into it
+	void smems(std::string_view read, std::vector<SMEM>& out, int min_len = 1) const;
+	std::vector<std::vector<SMEM>> smems_batch(std::span<const std::string> reads, int min_len = 1) const;
+
+	// both indexes in one file
+	void save(const std::string& path) const;
+	static BiFMIndex load(const std::string& path);
+
+private:
+	// SMEMs overlapping read[x], appended to out; returns where the longest
+	// match starting at x ends, the next x to try
+	int smemsAt(const std::vector<int>& codes, int x, std::vector<SMEM>& out) const;
+
+	FMIndex fwd;
+	FMIndex rev;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <algorithm>
+#include "Storage.hpp"
+#include "IndexFile.hpp"
+
+// Plain bit vector with rank support: a 32-bit count of set bits before
+// every 512-bit block, so rank() is one table read plus at most 8 popcounts.
+class BitVector {
+public:
+	BitVector() { }
+	explicit BitVector(size_t n) : n(n), words(n / 64 + 1, 0) { }
+
+	void set(size_t i) { words.mutableData()[i >> 6] |= (uint64_t(1) << (i & 63)); }
+	bool get(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+
+	// must be called once all bits are set
+	void buildRank() {
+		std::vector<uint32_t> ranks(words.size() / 8 + 1, 0);
+		uint32_t total = 0;
+		for (size_t w=0; w<words.size(); w++) {
+			if (w % 8 == 0) ranks[w / 8] = total;
+			total += std::popcount(words[w]);
+		}
+		block_rank = std::move(ranks);
+	}
+
+	// number of set bits in [0, i)
+	size_t rank(size_t i) const {
+		size_t w = i >> 6;
+		size_t r = block_rank[w >> 3];
+		for (size_t k=w & ~size_t(7); k<w; k++) r += std::popcount(words[k]);
+		return r + std::popcount(words[w] & ((uint64_t(1) << (i & 63)) - 1));
+	}
+
+	// first set bit at or after i, size() if there is none
+	size_t next(size_t i) const {
+		size_t w = i >> 6;
+		uint64_t bits = words[w] & (~uint64_t(0) << (i & 63));
+		while (bits == 0) {
+			if (++w >= words.size()) return n;
+			bits = words[w];
+		}
+		return std::min(n, (w << 6) + std::countr_zero(bits));
+	}
+
+	size_t size() const { return n; }
+	size_t bytes() const { return words.bytes() + block_rank.bytes(); }
+
+	void save(IndexWriter& out) const {
+		out.writeValue<uint64_t>(n);
+		out.write(words);
+		out.write(block_rank);
+	}
+	void load(IndexReader& in) {
+		n = in.nextValue<uint64_t>();
+		words = in.next<uint64_t>();
+		block_rank = in.next<uint32_t>();
+	}
+
+private:
+	size_t n = 0;
+	Storage<uint64_t> words;
+	Storage<uint32_t> block_rank;
+};
+
+#endif
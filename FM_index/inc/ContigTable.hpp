@@ -0,0 +1,56 @@
+#ifndef CONTIG_TABLE_H
+#define CONTIG_TABLE_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Storage.hpp"
+#include "IndexFile.hpp"
+
+// placed between consecutive contigs of the index text; reads without N can
+// never match across it, and hits of reads with N are filtered by resolve()
+constexpr char CONTIG_SEPARATOR = 'N';
+
+// Where each contig of a concatenated reference starts in the index text.
+// Lookups binary-search the start array, which holds one int per contig, so
+// the table stays small next to the index for any number of contigs.
+class ContigTable {
+public:
+	ContigTable() { }
+	// contigs laid out in order, one separator between neighbours
+	ContigTable(const std::vector<std::string>& names, const std::vector<int>& lengths);
+
+	// contigs of front placed ahead of these, as after FMIndex::add() of
+	// front's text joined by separators with one more at its end
+	void prepend(const ContigTable& front);
+
+	int size() const { return starts.size(); }
+	std::string_view name(int id) const {
+		return std::string_view(name_data.data() + name_offsets[id], name_offsets[id + 1] - name_offsets[id]);
+	}
+	int start(int id) const { return starts[id]; }
+	int length(int id) const { return lengths[id]; }
+
+	// contig holding text position pos, -1 on a separator or the final '$'
+	int find(int pos) const;
+	// contig and offset of a hit of len bases at text position pos; false if
+	// the hit does not lie within a single contig
+	bool resolve(int pos, int len, int& contig, int& offset) const;
+
+	size_t bytes() const { return starts.bytes() + lengths.bytes() + name_data.bytes() + name_offsets.bytes(); }
+
+	void save(IndexWriter& out) const;
+	void load(IndexReader& in);
+
+private:
+	Storage<int> starts;
+	Storage<int> lengths;
+	// names back to back, name i is [name_offsets[i], name_offsets[i+1])
+	Storage<char> name_data;
+	Storage<uint64_t> name_offsets;
+	// keeps the index file mapped when loaded from disk
+	std::shared_ptr<const MappedFile> mapping;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef DNA_BWT_H
+#define DNA_BWT_H
+#include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <bit>
+#include "Storage.hpp"
+#include "IndexFile.hpp"
+#include "Parallel.hpp"
+
+// symbol codes, A/C/G/T are the 2-bit packed ones
+enum DnaSymbol : int { DNA_A = 0, DNA_C = 1, DNA_G = 2, DNA_T = 3, DNA_N = 4, DNA_DOLLAR = 5, DNA_SIGMA = 6 };
+
+// char -> symbol code, -1 if the symbol is not part of the alphabet
+inline int dnaCode(char ch) {
+	static constexpr auto table = [] {
+		std::array<int8_t, 256> t{};
+		t.fill(-1);
+		t['A'] = DNA_A; t['C'] = DNA_C; t['G'] = DNA_G; t['T'] = DNA_T;
+		t['N'] = DNA_N; t['$'] = DNA_DOLLAR;
+		return t;
+	}();
+	return table[static_cast<unsigned char>(ch)];
+}
+
+// lexicographic order of the alphabet: $ < A < C < G < N < T
+inline constexpr int DNA_LEX_ORDER[DNA_SIGMA] = {DNA_DOLLAR, DNA_A, DNA_C, DNA_G, DNA_N, DNA_T};
+
+// position of a symbol code in DNA_LEX_ORDER, -1 for a code outside the
+// alphabet such as dnaCode()'s
+inline int dnaLexRank(int code) {
+	static constexpr auto table = [] {
+		std::array<int8_t, DNA_SIGMA> t{};
+		for (int r=0; r<DNA_SIGMA; r++) t[DNA_LEX_ORDER[r]] = r;
+		return t;
+	}();
+	return code >= 0 && code < DNA_SIGMA ? table[code] : -1;
+}
+
+inline char dnaChar(int code) {
+	return "ACGTN$"[code];
+}
+
+// 64-byte rank checkpoint: counts of A/C/G/T before the block followed by
+// the block's 192 symbols at 2 bits each, so one rank touches one cache line
+struct alignas(64) RankBlock {
+	uint32_t count[4];
+	uint64_t bits[6];
+};
+
+// BWT over ACGTN$ packed at 2 bits per symbol. N and '$' occupy an A slot
+// in the packed words; the single '$' row is stored explicitly and N rows as
+// sorted runs, which stay few because N-preceded suffixes cluster in the BWT.
+class DnaBWT {
+public:
+	static constexpr int SYMBOLS_PER_BLOCK = 192;
+
+	// pack symbol_at(0 .. n-1), counts are filled by buildCounts(); both split
+	// the blocks into one run per thread
+	template <typename F>
+	void build(int len, F symbol_at, int threads = 1);
+	void buildCounts(int threads = 1);
+
+	// occurrences of symbol code c in [0, i)
+	int rank(int c, int i) const {
+		if (c == DNA_N) return rankN(i);
+		if (c == DNA_DOLLAR) return dollar < i ? 1 : 0;
+		int r = rawRank(c, i);
+		// A slots also hold every N and the '$' before i
+		if (c == DNA_A) r -= rankN(i) + (dollar < i ? 1 : 0);
+		return r;
+	}
+
+	// symbol code at row i
+	int code(int i) const {
+		int c = (blocks[i / SYMBOLS_PER_BLOCK].bits[(i % SYMBOLS_PER_BLOCK) / 32] >> (2 * (i % 32))) & 3;
+		if (c == DNA_A) {
+			if (i == dollar) return DNA_DOLLAR;
+			if (rankN(i + 1) != rankN(i)) return DNA_N;
+		}
+		return c;
+	}
+	char operator[](int i) const { return dnaChar(code(i)); }
+
+	// pull the rank block of row i towards the cache ahead of rank(c, i)
+	void prefetch(int i) const { __builtin_prefetch(&blocks[i / SYMBOLS_PER_BLOCK]); }
+
+	int size() const { return n; }
+	int dollarRow() const { return dollar; }
+	size_t bytes() const { return blocks.bytes() + n_runs.bytes(); }
+
+	void save(IndexWriter& out) const;
+	void load(IndexReader& in);
+
+private:
+	struct Run {
+		int start, end;	// [start, end)
+		int before;		// N rows before start
+	};
+
+	static uint64_t matchMask(uint64_t word, int c) {
+		// one bit per 2-bit slot holding c, at the slot's low bit
+		uint64_t x = word ^ (0x5555555555555555ULL * c);
+		return ~(x | (x >> 1)) & 0x5555555555555555ULL;
+	}
+
+	// packed-slot count of c in [0, i), N and '$' counted as A
+	int rawRank(int c, int i) const {
+		const RankBlock& b = blocks[i / SYMBOLS_PER_BLOCK];
+		int j = i % SYMBOLS_PER_BLOCK;
+		int r = b.count[c];
+		int w = 0;
+		for (; j >= 32; j -= 32, w++) r += std::popcount(matchMask(b.bits[w], c));
+		if (j > 0) r += std::popcount(matchMask(b.bits[w], c) & ((uint64_t(1) << (2 * j)) - 1));
+		return r;
+	}
+
+	int rankN(int i) const {
+		if (n_runs.empty() || i <= n_runs.front().start) return 0;
+		const Run& last = n_runs.back();
+		if (i >= last.end) return last.before + last.end - last.start;
+		// last run starting before i
+		auto it = std::upper_bound(n_runs.begin(), n_runs.end(), i - 1,
+			[](int v, const Run& r) { return v < r.start; }) - 1;
+		return it->before + std::min(i, it->end) - it->start;
+	}
+
+	int n = 0;
+	int dollar = 0;		// n when the text has no '$'
+	Storage<RankBlock> blocks;
+	Storage<Run> n_runs;
+};
+
+template <typename F>
+void DnaBWT::build(int len, F symbol_at, int threads) {
+	n = len;
+	dollar = len;
+	blocks = Storage<RankBlock>(n / SYMBOLS_PER_BLOCK + 1, RankBlock{});
+	RankBlock* b = blocks.mutableData();
+	// each thread packs whole blocks and lists the N runs of its rows
+	std::vector<std::vector<Run>> part_runs(std::max(threads, 1));
+	parallelFor(threads, n, [&](int t, size_t begin, size_t end) {
+		std::vector<Run>& runs = part_runs[t];
+		for (int i=begin; i<int(end); i++) {
+			int c = dnaCode(symbol_at(i));
+			if (c < 0) {
+				throw std::invalid_argument("Unsupported symbol, the DNA index takes A/C/G/T/N and \"$\". ");
+			}
+			if (c == DNA_N) {
+				if (!runs.empty() && runs.back().end == i) runs.back().end++;
+				else runs.push_back({i, i + 1, 0});
+			} else if (c == DNA_DOLLAR) {
+				dollar = i;
+			}
+			uint64_t slot = c < 4 ? c : DNA_A;
+			b[i / SYMBOLS_PER_BLOCK].bits[(i % SYMBOLS_PER_BLOCK) / 32] |= slot << (2 * (i % 32));
+		}
+	}, SYMBOLS_PER_BLOCK);
+	// join runs meeting at a part boundary and count the N rows before each
+	std::vector<Run> runs;
+	int n_total = 0;
+	for (auto& part : part_runs) {
+		for (const Run& r : part) {
+			if (!runs.empty() && runs.back().end == r.start) runs.back().end = r.end;
+			else runs.push_back({r.start, r.end, n_total});
+			n_total += r.end - r.start;
+		}
+	}
+	runs.shrink_to_fit();
+	n_runs = std::move(runs);
+}
+
+#endif
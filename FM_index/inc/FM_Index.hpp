@@ -3,30 +3,191 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <algorithm>
-#include <unordered_map>
+#include <iterator>
+#include <array>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include "BitVector.hpp"
+#include "DnaBWT.hpp"
+#include "WaveletMatrix.hpp"
+#include "IndexFile.hpp"
+#include "Storage.hpp"
+
+// inclusive range of BWT rows [sp, ep], empty when sp > ep
+struct SAInterval {
+	int sp, ep;
+	int size() const { return sp > ep ? 0 : ep - sp + 1; }
+	bool empty() const { return sp > ep; }
+};
+
+// how BWT ranks are answered
+enum class RankBackend : int {
+	// ACGTN$ packed at 2 bits with interleaved counts, one cache line per rank
+	Dna,
+	// wavelet matrix over the text's own byte alphabet, log2(sigma) bit
+	// vectors, for protein or IUPAC-coded references
+	Wavelet,
+};
+
+struct FMIndexOptions {
+	// keep SA[i] only when SA[i] is a multiple of this, locate() walks
+	// at most sa_sample_rate - 1 LF steps to reach a sample
+	int sa_sample_rate = 32;
+	// precompute the SA interval of every k-mer (4^k entries of 8 bytes) so a
+	// search starts k characters in; 0 disables, 10-12 suits DNA reads
+	int kmer_length = 0;
+	// construction threads; above 1 the suffix array is built by parallel
+	// prefix doubling instead of SA-IS, and packing and counting are split too
+	int threads = 1;
+	// rank structure; Wavelet takes any byte alphabet but is O(log sigma) per
+	// rank and builds with SA-IS only, and the k-mer table, approximate and
+	// bidirectional search stay DNA-only
+	RankBackend backend = RankBackend::Dna;
+	// print the BWT, C table and SA samples after building, O(n) output
+	bool verbose = false;
+};
 
 class FMIndex {
 public:
 	FMIndex(){ };
-	FMIndex(const std::string& T) {
+	FMIndex(const std::string& T, const FMIndexOptions& opt = FMIndexOptions())
+		: backend(opt.backend), sa_rate(opt.sa_sample_rate), build_threads(opt.threads) {
+		if (sa_rate < 1) {
+			throw std::invalid_argument("SA sample rate must be at least 1. ");
+		}
+		if (build_threads < 1) {
+			throw std::invalid_argument("Thread count must be at least 1. ");
+		}
 		buildBWT(T);
-		buildC();
 		buildOcc();
-		print();
+		buildC();
+		buildKmerTable(opt.kmer_length);
+		if (opt.verbose) print();
 	}
 	~FMIndex(){ };
+	// build from the '$'-terminated index text stored in text_path, for texts
+	// too large to sort in memory: the BWT grows one block at a time from the
+	// end of the text, merging each block into the BWT so far, which is kept
+	// on disk in tmp_dir; blocks are sized to keep the build near memory_budget
+	static FMIndex buildExternal(const std::string& text_path, size_t memory_budget,
+		const std::string& tmp_dir, const FMIndexOptions& opt = FMIndexOptions());
+	// index of T reversed with '$' kept at the end, the second index of
+	// BiFMIndex and ApproxSearcher; neither locates through it, so the
+	// suffix array is sampled at a single position
+	static FMIndex buildReverse(const std::string& T);
+	// merge more sequences into the index without rebuilding it: they take
+	// text positions [0, L) and the old text moves up by L, so old suffixes
+	// keep their order and only the L new ones are sorted, as one block of
+	// buildExternal; end them with CONTIG_SEPARATOR to keep reads from
+	// matching across. Only the sort of the L new suffixes scales with L: the
+	// packed BWT, its rank counts and the SA samples are rewritten in
+	// sequential passes and the k-mer table is rebuilt, since inserted rows
+	// shift every interval. A call costs O(n + L) plus the table's 4^k
+	// searches, so it pays off while L is small next to n. DNA backend only
+	void add(std::string_view sequences);
 	void buildBWT(const std::string& T);
 	void buildC();
 	void buildOcc();
+	// (re)build the k-mer interval table, k = 0 drops it
+	void buildKmerTable(int k);
 	void print();
-	std::vector<int> query(const std::string& pattern);
+	std::vector<int> query(const std::string& pattern) const;
+	// backward search only: the rows whose suffixes start with pattern
+	SAInterval search(std::string_view pattern) const;
+	// one backward-search step: rows of range whose suffixes are preceded by
+	// symbol code c
+	SAInterval extend(const SAInterval& range, int c) const {
+		return {C[c] + occ(c, range.sp), C[c] + occ(c, range.ep + 1) - 1};
+	}
+	// symbol code of ch in this index, -1 if ch does not occur in the text
+	// alphabet; the DnaSymbol codes for the Dna backend
+	int symbolCode(char ch) const { return codes[static_cast<unsigned char>(ch)]; }
+	RankBackend rankBackend() const { return backend; }
+	// every row, the range of the empty pattern
+	SAInterval all() const { return {0, int(sa_sampled.size()) - 1}; }
+	// number of occurrences, no suffix array access and no allocation
+	int count(std::string_view pattern) const { return search(pattern).size(); }
+	// query() for many patterns: up to `group` searches advance in lockstep and
+	// each prefetches its next rank blocks before the others run, so the cache
+	// misses of different patterns overlap instead of serialising
+	std::vector<std::vector<int>> query_batch(std::span<const std::string> patterns, int group = 32) const;
+	// the lockstep search alone: the matching row range of every pattern
+	void search_batch(std::span<const std::string> patterns, std::span<SAInterval> out, int group = 32) const;
+
+	// write the index to path; load() maps it back read-only, sections are
+	// used in place so processes sharing the file share its page cache, or
+	// copied into index memory when resident (see IndexReader)
+	void save(const std::string& path) const;
+	static FMIndex load(const std::string& path, bool resident = false);
+	// the same sections written into / read from a file shared with other data
+	void save(IndexWriter& out) const;
+	static FMIndex load(IndexReader& in);
+
+	// text position of BWT row
+	int locate(int row) const;
+	// text positions of every row in range, written through out
+	template <typename OutputIt>
+	OutputIt locate(const SAInterval& range, OutputIt out) const {
+		for (int i=range.sp; i<=range.ep; i++) *out++ = locate(i);
+		return out;
+	}
+	// fills buffer with up to buffer.size() hit positions of pattern and
+	// returns the total number of hits, so a reused buffer never reallocates
+	int locate(std::string_view pattern, std::span<int> buffer) const;
+	// text[pos, pos + len) recovered from the BWT alone: LF steps back from the
+	// first sampled inverse-SA position at or after pos + len, at most
+	// len + sa_rate - 1 steps, so the index can be served without its text
+	std::string extract(int pos, int len) const;
+	// the whole text, '$' included, by extract() over one run of positions
+	// per thread; for checking an index against its reference
+	std::string invert(int threads = 1) const;
+	// memory held by the sampled suffix array and inverse suffix array
+	size_t saBytes() const;
+	// memory held by the BWT and its rank structure
+	size_t bwtBytes() const { return backend == RankBackend::Dna ? bwt.bytes() : wavelet.bytes(); }
+	// memory held by the k-mer interval table
+	size_t kmerBytes() const { return kmer_table.bytes(); }
 
 private:
-	std::string bwt;
-	std::vector<int> suffix_array;
-	std::unordered_map<char, int> C;
-	std::unordered_map<char, std::vector<int>> Occ;
+	// occurrences of symbol code c in BWT rows [0, i)
+	int occ(int c, int i) const { return backend == RankBackend::Dna ? bwt.rank(c, i) : wavelet.rank(c, i); }
+	int codeAt(int row) const { return backend == RankBackend::Dna ? bwt.code(row) : wavelet.access(row); }
+	char symbolChar(int c) const { return backend == RankBackend::Dna ? dnaChar(c) : alphabet[c]; }
+	int LF(int row) const;
+	void extractInto(int pos, int len, char* out) const;
+	void sampleSA(const std::vector<int>& suffix_array);
+	// interval of pattern's last kmer_k characters from the table; i is left at
+	// the next character to search, returns false if the table cannot be used
+	bool kmerStart(std::string_view pattern, SAInterval& range, int& i) const;
+	static std::array<int16_t, 256> dnaCodes();
+
+	RankBackend backend = RankBackend::Dna;
+	DnaBWT bwt;
+	// Wavelet backend: the BWT as codes 0 .. sigma-1, code 0 is '$' and the
+	// rest follow byte order; alphabet maps codes back to bytes
+	WaveletMatrix wavelet;
+	std::string alphabet;
+	// byte -> symbol code, -1 outside the alphabet
+	std::array<int16_t, 256> codes = dnaCodes();
+	int sa_rate = 1;
+	BitVector sa_sampled;
+	Storage<int> sa_samples;
+	// inverse SA samples: the rows of the sampled text positions, in position
+	// order; position 0 is always sampled
+	BitVector isa_sampled;
+	Storage<int> isa_samples;
+	// C[c]: number of symbols smaller than c, indexed by symbol code
+	std::vector<int> C = std::vector<int>(DNA_SIGMA, 0);
+	// SA interval of every ACGT k-mer, indexed by its 2-bit code
+	int kmer_k = 0;
+	Storage<SAInterval> kmer_table;
+	// threads used by the build steps, not stored with the index
+	int build_threads = 1;
+	// keeps the index file mapped when loaded from disk
+	std::shared_ptr<const MappedFile> mapping;
 };
 
 #endif
@@ -0,0 +1,67 @@
+#ifndef HUGE_PAGES_H
+#define HUGE_PAGES_H
+#include <cstddef>
+#include <new>
+
+// Where large index arrays get their pages. Backward search touches one
+// rank block per step at a random place in the index, so on a multi-GB index
+// nearly every step misses the TLB with 4 KB pages; 2 MB pages cut the page
+// walks by 512x.
+enum class HugePageMode : int {
+	// 2 MB aligned mapping without advice, transparent hugepages as the
+	// system THP setting decides
+	System,
+	// normal pages, transparent hugepages refused for the mapping; only for
+	// A/B measurements against the others
+	ForceOff,
+	// 2 MB aligned mapping with madvise(MADV_HUGEPAGE), the kernel backs it
+	// with hugepages when it can spare them
+	Transparent,
+	// MAP_HUGETLB from the reserved pool (vm.nr_hugepages), Transparent when
+	// the pool is empty
+	Explicit,
+};
+
+// applies to allocations made after the call, default System
+void setHugePageMode(HugePageMode mode);
+HugePageMode hugePageMode();
+
+// bytes currently served by each kind of mapping. transparent and system
+// bytes are mapped, not granted: whether the kernel backs them with
+// hugepages shows only in AnonHugePages of /proc/self/smaps_rollup.
+struct HugePageStats {
+	size_t hugetlb = 0;
+	size_t transparent = 0;
+	// System mode, left to the system THP setting
+	size_t system = 0;
+	// ForceOff mode
+	size_t normal = 0;
+};
+HugePageStats hugePageStats();
+
+// allocations of at least this many bytes are mapped, smaller ones come from
+// operator new
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+void* allocateIndexMemory(size_t bytes);
+void freeIndexMemory(void* p, size_t bytes);
+
+// allocator for index arrays, see Storage
+template <typename T>
+struct IndexAllocator {
+	using value_type = T;
+	IndexAllocator() = default;
+	template <typename U>
+	IndexAllocator(const IndexAllocator<U>&) { }
+
+	T* allocate(size_t n) {
+		if (n > size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+		return static_cast<T*>(allocateIndexMemory(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t n) { freeIndexMemory(p, n * sizeof(T)); }
+
+	template <typename U>
+	bool operator==(const IndexAllocator<U>&) const { return true; }
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef INDEX_FILE_H
+#define INDEX_FILE_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include "Storage.hpp"
+
+// On-disk index layout:
+//   header (64 bytes) | sections, each 64-byte aligned | section table
+// Sections are raw arrays written in a fixed order by the index classes and
+// read back in the same order, so loading maps them without copying.
+constexpr uint32_t INDEX_FILE_VERSION = 4;
+constexpr uint32_t INDEX_BYTE_ORDER = 0x01020304;
+constexpr size_t INDEX_SECTION_ALIGN = 64;
+
+struct IndexFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t table_offset;
+	uint64_t section_count;
+	uint8_t reserved[32];
+};
+
+struct IndexSection {
+	uint64_t offset;
+	uint64_t bytes;
+};
+
+class IndexWriter {
+public:
+	explicit IndexWriter(const std::string& path);
+
+	template <typename T>
+	void write(const T* data, size_t count) {
+		static_assert(std::is_trivially_copyable_v<T>, "index sections must be trivially copyable");
+		writeSection(data, count * sizeof(T));
+	}
+	template <typename T>
+	void write(const Storage<T>& s) { write(s.data(), s.size()); }
+	template <typename T>
+	void writeValue(const T& value) { write(&value, 1); }
+
+	// write the section table and patch the header
+	void finish();
+
+private:
+	size_t align();
+	void writeSection(const void* data, size_t bytes);
+
+	std::string path;
+	std::ofstream out;
+	std::vector<IndexSection> table;
+};
+
+// read-only, shared mapping of a whole file
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data() const { return base; }
+	size_t size() const { return len; }
+
+private:
+	const uint8_t* base = nullptr;
+	size_t len = 0;
+};
+
+class IndexReader {
+public:
+	// resident: copy every section into index memory instead of viewing the
+	// mapping, so the index can sit on hugepages (file mappings keep 4 KB
+	// pages) at the cost of reading it all up front
+	explicit IndexReader(const std::string& path, bool resident = false);
+
+	// view of the next section, valid while mapping() is alive, or an owning
+	// copy when resident
+	template <typename T>
+	Storage<T> next() {
+		static_assert(std::is_trivially_copyable_v<T>, "index sections must be trivially copyable");
+		const IndexSection& s = nextSection();
+		if (s.bytes % sizeof(T) != 0) {
+			throw std::runtime_error("Corrupt index file: section size does not match its type. ");
+		}
+		const T* p = reinterpret_cast<const T*>(file->data() + s.offset);
+		if (resident) return Storage<T>(IndexVector<T>(p, p + s.bytes / sizeof(T)));
+		return Storage<T>::view(p, s.bytes / sizeof(T));
+	}
+	template <typename T>
+	T nextValue() {
+		Storage<T> s = next<T>();
+		if (s.size() != 1) {
+			throw std::runtime_error("Corrupt index file: expected a single value. ");
+		}
+		return s[0];
+	}
+
+	// what loaded objects hold on to, nothing once the sections are copied
+	std::shared_ptr<const MappedFile> mapping() const { return resident ? nullptr : file; }
+
+private:
+	const IndexSection& nextSection();
+
+	std::shared_ptr<const MappedFile> file;
+	const IndexSection* table = nullptr;
+	size_t section_count = 0;
+	size_t cursor = 0;
+	bool resident = false;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+// fn(t, begin, end) for `threads` contiguous parts of [0, n), part t on its
+// own thread. Part boundaries are multiples of align so parts can write
+// packed words without sharing them. The first exception a part throws is
+// rethrown once every part has finished.
+template <typename F>
+void parallelFor(int threads, size_t n, F fn, size_t align = 1) {
+	threads = std::max(threads, 1);
+	size_t per_part = (n + threads - 1) / threads;
+	per_part = (per_part + align - 1) / align * align;
+	if (threads == 1 || n <= per_part) {
+		fn(0, size_t(0), n);
+		return;
+	}
+	std::vector<std::thread> workers;
+	std::vector<std::exception_ptr> errors(threads);
+	for (int t=0; t<threads; t++) {
+		size_t begin = std::min(n, t * per_part);
+		size_t end = std::min(n, begin + per_part);
+		workers.emplace_back([&, t, begin, end]() {
+			try {
+				fn(t, begin, end);
+			} catch (...) {
+				errors[t] = std::current_exception();
+			}
+		});
+	}
+	for (auto& w : workers) {
+		w.join();
+	}
+	for (auto& e : errors) {
+		if (e) std::rethrow_exception(e);
+	}
+}
+
+#endif
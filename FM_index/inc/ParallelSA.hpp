@@ -0,0 +1,15 @@
+#ifndef PARALLEL_SA_H
+#define PARALLEL_SA_H
+#include <string>
+#include <vector>
+
+// Suffix array of T by prefix doubling on `threads` threads, for the same
+// input as buildSuffixArray(): ACGTN text ending in a unique '$'. Suffixes are
+// bucketed by their first symbols with a parallel counting sort, then each
+// round sorts every unresolved bucket by the rank of the suffix h symbols
+// further on, doubling h, with buckets spread across threads. O(n log n)
+// work against SA-IS's O(n), in exchange for scaling with cores; needs 8n
+// bytes plus the buckets being refined.
+void buildSuffixArrayParallel(const std::string& T, std::vector<int>& SA, int threads);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef RL_FM_INDEX_H
+#define RL_FM_INDEX_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include "FM_Index.hpp"
+
+// Run-length FM-index for highly repetitive texts: everything it stores is
+// per BWT run, so its size follows the number of runs r rather than n.
+//  - rank: run start rows plus, per symbol, the indexes of its runs and their
+//    running lengths; one binary search for the run, one for the symbol's
+//    runs before it
+//  - locate (r-index): backward search keeps SA of the range's last row,
+//    known from the SA at run ends; the other hits follow from
+//    phi(p) = SA[ISA[p] - 1], taken from the SA at run starts
+class RLFMIndex {
+public:
+	RLFMIndex() { }
+	explicit RLFMIndex(const std::string& T);
+
+	std::vector<int> query(const std::string& pattern) const;
+	SAInterval search(std::string_view pattern) const;
+	int count(std::string_view pattern) const { return search(pattern).size(); }
+
+	int size() const { return n; }
+	int runs() const { return run_start.size(); }
+	size_t bytes() const;
+
+	void save(const std::string& path) const;
+	static RLFMIndex load(const std::string& path);
+
+private:
+	// occurrences of symbol code c in rows [0, i)
+	int rank(int c, int i) const;
+	// run holding row i
+	int runOf(int i) const;
+	// backward search that also returns SA at the range's last row
+	SAInterval search(std::string_view pattern, int& last_sa) const;
+	int phi(int pos) const;
+
+	int n = 0;
+	std::array<int, DNA_SIGMA> C{};
+	Storage<int> run_start;
+	Storage<uint8_t> run_code;
+	// per symbol: indexes of its runs, and the length of its first k runs
+	std::array<Storage<int>, DNA_SIGMA> code_runs;
+	std::array<Storage<int>, DNA_SIGMA> code_before;
+	// SA at the last row of every run
+	Storage<int> end_sa;
+	// SA at each run start but the first, sorted, with SA one row above
+	Storage<int> phi_from;
+	Storage<int> phi_to;
+	// keeps the index file mapped when loaded from disk
+	std::shared_ptr<const MappedFile> mapping;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef READ_MAPPER_H
+#define READ_MAPPER_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FM_Index.hpp"
+#include "BiFMIndex.hpp"
+#include "StripedSW.hpp"
+#include "ContigTable.hpp"
+
+struct MapperOptions {
+	// exact seeds: non-overlapping substrings of this length tiling the read;
+	// SMEM seeds: the minimum SMEM length
+	int seed_length = 19;
+	// seeds with more hits than this are repeats and not located
+	int max_occ = 500;
+	// seed hits whose diagonals (text position - read offset) lie within this
+	// many bases chain into one candidate; windows are padded by it too
+	int band = 32;
+	// candidate windows aligned per read, best chains first over both strands
+	int max_candidates = 8;
+	// best alignments scoring below this leave the read unmapped
+	int min_score = 30;
+	AlignScoring scoring;
+};
+
+// best alignment of a read: reference coordinates are text positions, query
+// coordinates are on the read as aligned, reverse complemented for the
+// reverse strand
+struct Mapping {
+	bool mapped = false;
+	bool reverse = false;
+	// best score among the other candidate windows, 0 when there were none
+	int second_score = 0;
+	Alignment alignment;
+};
+
+// Seed-and-extend: exact or SMEM seeds from the FM-index are located and
+// chained by diagonal into candidate windows, and only those windows are
+// aligned, by the striped Smith-Waterman with one query profile per strand.
+// Windows come from the text when given, else FMIndex::extract() recovers
+// them from the index, slower but without the text in memory. With a contig
+// table a chain gets one window per contig its seeds land on, clipped to
+// that contig, so a read near a contig end aligns with a soft clip instead
+// of across the separator.
+class ReadMapper {
+public:
+	// exact seeds from index
+	ReadMapper(const FMIndex& index, std::string_view text, const ContigTable* contigs = nullptr,
+		const MapperOptions& opt = MapperOptions());
+	// SMEM seeds from the bidirectional index
+	ReadMapper(const BiFMIndex& index, std::string_view text, const ContigTable* contigs = nullptr,
+		const MapperOptions& opt = MapperOptions());
+
+	Mapping map(std::string_view read) const;
+
+private:
+	// seed hit: text position of read offset 0 on the diagonal, and the
+	// read bases the seed covers
+	struct SeedHit {
+		int diagonal;
+		int begin, end;
+	};
+	struct Candidate {
+		int covered;
+		bool reverse;
+		int first, last;	// text window [first, last)
+	};
+
+	void collectHits(std::string_view read, std::vector<SeedHit>& hits) const;
+	void chainHits(std::vector<SeedHit>& hits, int read_len, bool reverse, std::vector<Candidate>& out) const;
+	std::string_view window(const Candidate& c, std::string& buffer) const;
+
+	const FMIndex* fm;
+	const BiFMIndex* bi = nullptr;
+	std::string_view text;
+	const ContigTable* contigs;
+	MapperOptions opt;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SAIS_H
+#define SAIS_H
+#include <string>
+#include <vector>
+
+// Suffix array of T by induced sorting (SA-IS, Nong/Zhang/Chan 2009).
+// T must end with a unique '$', which acts as the sentinel and sorts before
+// every other symbol. Runs in O(n) time and reads the text in place. Apart
+// from SA itself (4n bytes) each level keeps one type bit per symbol (under
+// n/4 bytes over all levels); the reduced texts, their SAs and, when they
+// fit, their buckets live inside SA. A level whose buckets do not fit in the
+// gap allocates them, at most n/2 ints, and only for nearly all-distinct
+// LMS substrings; the top level of a byte text uses two arrays of 257 ints.
+void buildSuffixArray(const std::string& T, std::vector<int>& SA);
+
+// the same over an integer text with symbols in [0, K], ending in a unique 0
+void buildSuffixArray(const std::vector<int>& T, std::vector<int>& SA, int K);
+
+#endif
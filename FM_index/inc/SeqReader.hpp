@@ -0,0 +1,38 @@
+#ifndef SEQ_READER_H
+#define SEQ_READER_H
+#include <string>
+#include <fstream>
+#include "ContigTable.hpp"
+
+struct SeqRecord {
+	std::string name;
+	std::string seq;
+};
+
+// Streams records from a FASTA (multi-line sequences) or FASTQ (4-line
+// records) file; the format is taken from the first character of the file.
+class SeqReader {
+public:
+	explicit SeqReader(const std::string& path);
+	// false once the file is exhausted
+	bool next(SeqRecord& rec);
+
+private:
+	std::ifstream in;
+	std::string line;
+	bool fastq = false;
+	bool has_line = false;	// `line` holds a header not yet consumed
+};
+
+// upper-case in place, anything other than A/C/G/T becomes N
+void normalizeSequence(std::string& seq);
+
+// every sequence of a FASTA reference joined by CONTIG_SEPARATOR as index
+// text, normalised and '$'-terminated; contigs records where each one lies
+std::string readReference(const std::string& path, ContigTable& contigs);
+
+// readReference() written to text_path instead of memory, holding one contig
+// at a time, as input for FMIndex::buildExternal()
+void writeReferenceText(const std::string& path, const std::string& text_path, ContigTable& contigs);
+
+#endif
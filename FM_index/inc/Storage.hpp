@@ -0,0 +1,85 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "HugePages.hpp"
+
+// vector whose large buffers follow the hugepage mode
+template <typename T>
+using IndexVector = std::vector<T, IndexAllocator<T>>;
+
+// Contiguous array that either owns its elements or views memory owned
+// elsewhere, e.g. a section of a memory-mapped index file. Index structures
+// are built into owning storage and served from either kind; mutableData()
+// is only valid on owning storage. Owned elements live in index memory, see
+// HugePageMode.
+template <typename T>
+class Storage {
+public:
+	Storage() { }
+	Storage(IndexVector<T>&& v) : owned(std::move(v)), ptr(owned.data()), len(owned.size()) { }
+	// copied into index memory, v is released
+	Storage(std::vector<T>&& v) : owned(v.begin(), v.end()), ptr(owned.data()), len(owned.size()) {
+		std::vector<T>().swap(v);
+	}
+	Storage(size_t n, const T& value) : owned(n, value), ptr(owned.data()), len(n) { }
+
+	static Storage view(const T* p, size_t n) {
+		Storage s;
+		s.ptr = p;
+		s.len = n;
+		s.is_view = true;
+		return s;
+	}
+
+	Storage(const Storage& other) : owned(other.owned), is_view(other.is_view) {
+		ptr = is_view ? other.ptr : owned.data();
+		len = other.len;
+	}
+	Storage& operator=(const Storage& other) {
+		if (this != &other) {
+			owned = other.owned;
+			is_view = other.is_view;
+			ptr = is_view ? other.ptr : owned.data();
+			len = other.len;
+		}
+		return *this;
+	}
+	Storage(Storage&& other) noexcept
+		: owned(std::move(other.owned)), ptr(other.ptr), len(other.len), is_view(other.is_view) {
+		other.ptr = nullptr;
+		other.len = 0;
+	}
+	Storage& operator=(Storage&& other) noexcept {
+		if (this != &other) {
+			owned = std::move(other.owned);
+			ptr = other.ptr;
+			len = other.len;
+			is_view = other.is_view;
+			other.ptr = nullptr;
+			other.len = 0;
+		}
+		return *this;
+	}
+
+	const T& operator[](size_t i) const { return ptr[i]; }
+	const T* data() const { return ptr; }
+	T* mutableData() { return owned.data(); }
+	const T* begin() const { return ptr; }
+	const T* end() const { return ptr + len; }
+	const T& front() const { return ptr[0]; }
+	const T& back() const { return ptr[len - 1]; }
+	size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+	size_t bytes() const { return len * sizeof(T); }
+	bool isView() const { return is_view; }
+
+private:
+	IndexVector<T> owned;
+	const T* ptr = nullptr;
+	size_t len = 0;
+	bool is_view = false;
+};
+
+#endif
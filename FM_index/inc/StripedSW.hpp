@@ -0,0 +1,69 @@
+#ifndef STRIPED_SW_H
+#define STRIPED_SW_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <xsimd/xsimd.hpp>
+
+// affine gaps: a gap of g symbols costs gap_open + (g - 1) * gap_extend;
+// defaults are HW2's
+struct AlignScoring {
+	int match = 2;
+	int mismatch = 2;
+	int gap_open = 3;
+	int gap_extend = 1;
+};
+
+// best local alignment score and the last aligned symbol of each sequence,
+// ends are -1 when nothing scores above 0
+struct LocalHit {
+	int score = 0;
+	int ref_end = -1;
+	int query_end = -1;
+};
+
+// one local alignment; ends are exclusive, the cigar uses M/I/D with S for
+// the clipped ends of the query
+struct Alignment {
+	int score = 0;
+	int ref_begin = 0, ref_end = 0;
+	int query_begin = 0, query_end = 0;
+	std::string cigar;
+};
+
+// Farrar's striped Smith-Waterman over 16-bit lanes, the layout of HW2's
+// striped_smith_waterman(). That function cannot be shared as is. It
+// restripes the query on every call where the mapper aligns one read
+// against many windows. It compares codes instead of scoring from a
+// profile, so N matches N. It adds the gap penalties unsaturated and with
+// the opposite sign. It reports ends only, and picks the best column by a
+// lane-wise compare. Here the query profile is built once per read and
+// every reference window reuses it. Query position q sits in segment
+// q % segs, lane q / segs. align() works in per-profile buffers, one
+// profile per thread.
+class QueryProfile {
+public:
+	explicit QueryProfile(std::string_view query, const AlignScoring& scoring = AlignScoring());
+
+	LocalHit align(std::string_view ref) const;
+	int size() const { return len; }
+
+private:
+	using Batch = xsimd::batch<int16_t>;
+	using Batches = std::vector<Batch, xsimd::aligned_allocator<Batch>>;
+
+	int len, segs;
+	AlignScoring sc;
+	// segs batches for each reference symbol code A/C/G/T/N
+	Batches profile;
+	mutable Batches h_load, h_store, e;
+};
+
+// scalar affine-gap traceback of the best local alignment ending at
+// ref[ref_end] and query[query_end], the end QueryProfile::align() reports;
+// the DP covers only the query prefix and the reference reachable from it
+Alignment tracebackAlign(std::string_view query, std::string_view ref, const LocalHit& hit,
+	const AlignScoring& scoring = AlignScoring());
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef WAVELET_MATRIX_H
+#define WAVELET_MATRIX_H
+#include <vector>
+#include <cstdint>
+#include "BitVector.hpp"
+#include "IndexFile.hpp"
+
+// Wavelet matrix over symbols 0 .. sigma-1: one bit vector per bit of the
+// symbol code, most significant first, each level stably sorting the
+// sequence by that bit. rank and access take one BitVector rank per level,
+// O(log sigma), in n * ceil(log2 sigma) bits plus the rank samples.
+class WaveletMatrix {
+public:
+	WaveletMatrix() { }
+
+	// symbols[i] < sigma for every i
+	void build(const std::vector<uint8_t>& symbols, int sigma);
+
+	// occurrences of c in [0, i)
+	int rank(int c, int i) const {
+		int sp = 0, ep = i;
+		for (int l=0; l<int(levels.size()); l++) {
+			const BitVector& bv = levels[l];
+			if ((c >> (levels.size() - 1 - l)) & 1) {
+				sp = zeros[l] + bv.rank(sp);
+				ep = zeros[l] + bv.rank(ep);
+			} else {
+				sp -= bv.rank(sp);
+				ep -= bv.rank(ep);
+			}
+		}
+		return ep - sp;
+	}
+
+	// symbol at i
+	int access(int i) const {
+		int c = 0;
+		for (int l=0; l<int(levels.size()); l++) {
+			const BitVector& bv = levels[l];
+			int b = bv.get(i);
+			c = (c << 1) | b;
+			i = b ? zeros[l] + bv.rank(i) : i - bv.rank(i);
+		}
+		return c;
+	}
+
+	int size() const { return n; }
+	size_t bytes() const {
+		size_t total = zeros.size() * sizeof(int);
+		for (auto& bv : levels) total += bv.bytes();
+		return total;
+	}
+
+	void save(IndexWriter& out) const;
+	void load(IndexReader& in);
+
+private:
+	int n = 0;
+	std::vector<BitVector> levels;
+	// zeros at each level, where that level's ones start in the next
+	std::vector<int> zeros;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "ApproxSearch.hpp"
+
+void ApproxSearcher::lowerBounds(std::string_view pattern, std::vector<int>& D) const {
+	// extend p[j..i] to the right through the reversed text; when it stops
+	// occurring, p[j..i] needs one more difference and the scan restarts at i+1
+	const int m = pattern.size();
+	D.resize(m);
+	SAInterval range = rev.all();
+	int z = 0;
+	for (int i=0; i<m; i++) {
+		int c = dnaCode(pattern[i]);
+		if (c >= 0 && c <= DNA_T) range = rev.extend(range, c);
+		if (c < 0 || c > DNA_T || range.empty()) {
+			z++;
+			range = rev.all();
+		}
+		D[i] = z;
+	}
+}
+
+bool ApproxSearcher::search(std::string_view pattern, const ApproxOptions& opt, std::vector<ApproxHit>& hits) const {
+	if (opt.max_diffs < 0 || opt.max_diffs > 2) {
+		throw std::invalid_argument("Approximate search supports 0 to 2 differences. ");
+	}
+	hits.clear();
+	const int m = pattern.size();
+	std::vector<int> D;
+	lowerBounds(pattern, D);
+	if (m > 0 && D[m - 1] > opt.max_diffs) return true;
+
+	const bool edits = opt.model == ErrorModel::Edit;
+	size_t work = 0;
+	bool exhausted = false;
+	// p[0..i] is left to match into range with z differences to spend; N in
+	// the read never matches, N in the text is never substituted in
+	auto step = [&](auto& self, int i, int z, SAInterval range) -> void {
+		if (exhausted) return;
+		if (i < 0) {
+			hits.push_back({range, opt.max_diffs - z});
+			return;
+		}
+		if (z < D[i]) return;
+		int p = dnaCode(pattern[i]);
+		// the exact base first, so cheap hits are found before the budget runs out
+		int order[4] = {0, 1, 2, 3};
+		if (p >= 0 && p <= DNA_T) std::swap(order[0], order[p]);
+		for (int c : order) {
+			int cost = c == p ? 0 : 1;
+			if (cost > z) continue;
+			if (++work > opt.work_budget) {
+				exhausted = true;
+				return;
+			}
+			SAInterval next = fwd.extend(range, c);
+			if (next.empty()) continue;
+			self(self, i - 1, z - cost, next);
+			// an extra text base before p[i+1..]; never at the read's end, where
+			// it would only widen the hit by one base
+			if (edits && z > 0 && i < m - 1) self(self, i, z - 1, next);
+		}
+		// p[i] missing from the text; skipping a read end is left to mismatches
+		if (edits && z > 0 && i < m - 1 && i > 0) self(self, i - 1, z - 1, range);
+	};
+	step(step, m - 1, opt.max_diffs, fwd.all());
+
+	// the same rows can be reached along several paths, keep the cheapest
+	std::sort(hits.begin(), hits.end(), [](const ApproxHit& a, const ApproxHit& b) {
+		if (a.range.sp != b.range.sp) return a.range.sp < b.range.sp;
+		if (a.range.ep != b.range.ep) return a.range.ep < b.range.ep;
+		return a.diffs < b.diffs;
+	});
+	hits.erase(std::unique(hits.begin(), hits.end(), [](const ApproxHit& a, const ApproxHit& b) {
+		return a.range.sp == b.range.sp && a.range.ep == b.range.ep;
+	}), hits.end());
+	return !exhausted;
+}
@@ -0,0 +1,114 @@
+#include "BiFMIndex.hpp"
+
+BiFMIndex::BiFMIndex(const std::string& T, const FMIndexOptions& opt) {
+	if (opt.backend != RankBackend::Dna) {
+		throw std::invalid_argument("The bidirectional index needs the DNA rank backend. ");
+	}
+	fwd = FMIndex(T, opt);
+	rev = FMIndex::buildReverse(T);
+}
+
+// rows of range whose preceding symbol sorts before c
+static int smallerCount(const FMIndex& fm, const SAInterval& range, int c) {
+	int total = 0;
+	for (int s : DNA_LEX_ORDER) {
+		if (s == c) break;
+		total += fm.extend(range, s).size();
+	}
+	return total;
+}
+
+BiInterval BiFMIndex::extendLeft(const BiInterval& range, int c) const {
+	return {fwd.extend(range.fwd, c), range.rev_sp + smallerCount(fwd, range.fwd, c)};
+}
+
+BiInterval BiFMIndex::extendRight(const BiInterval& range, int c) const {
+	SAInterval r = rev.extend(range.rev(), c);
+	int sp = range.fwd.sp + smallerCount(rev, range.rev(), c);
+	return {{sp, sp + r.ep - r.sp}, r.sp};
+}
+
+int BiFMIndex::smemsAt(const std::vector<int>& codes, int x, std::vector<SMEM>& out) const {
+	const int m = codes.size();
+	auto usable = [&](int i) { return i >= 0 && i < m && codes[i] <= DNA_T; };
+	if (!usable(x)) return x + 1;
+	BiInterval ik = extendLeft(all(), codes[x]);
+	if (ik.empty()) return x + 1;
+
+	// grow read[x..] to the right, keeping each match whose row range is about
+	// to shrink: extending it further loses occurrences, so it may be a MEM
+	struct Match {
+		BiInterval range;
+		int end;
+	};
+	std::vector<Match> curr, prev;
+	int i = x + 1;
+	for (; usable(i); i++) {
+		BiInterval ok = extendRight(ik, codes[i]);
+		if (ok.size() != ik.size()) curr.push_back({ik, i});
+		if (ok.empty()) break;
+		ik = ok;
+	}
+	if (!usable(i)) curr.push_back({ik, i});
+	int next = curr.back().end;
+
+	// grow every kept match to the left, longest first; a match that cannot
+	// grow is a MEM, and an SMEM unless a longer one already stopped here
+	std::reverse(curr.begin(), curr.end());
+	std::swap(curr, prev);
+	size_t first = out.size();
+	for (i = x - 1; i >= -1; i--) {
+		curr.clear();
+		for (auto& p : prev) {
+			BiInterval ok = usable(i) ? extendLeft(p.range, codes[i]) : BiInterval{{1, 0}, 0};
+			if (ok.empty()) {
+				if (curr.empty() && (out.size() == first || i + 1 < out.back().begin)) {
+					out.push_back({i + 1, p.end, p.range.fwd});
+				}
+			} else if (curr.empty() || ok.size() != curr.back().range.size()) {
+				curr.push_back({ok, p.end});
+			}
+		}
+		if (curr.empty()) break;
+		std::swap(curr, prev);
+	}
+	// found right to left
+	std::reverse(out.begin() + first, out.end());
+	return next;
+}
+
+void BiFMIndex::smems(std::string_view read, std::vector<SMEM>& out, int min_len) const {
+	out.clear();
+	std::vector<int> codes(read.size());
+	for (size_t i=0; i<read.size(); i++) {
+		int c = dnaCode(read[i]);
+		codes[i] = c < 0 ? DNA_N : c;
+	}
+	for (int x=0; x<int(codes.size()); ) {
+		x = smemsAt(codes, x, out);
+	}
+	out.erase(std::remove_if(out.begin(), out.end(), [&](const SMEM& s) { return s.length() < min_len; }), out.end());
+}
+
+std::vector<std::vector<SMEM>> BiFMIndex::smems_batch(std::span<const std::string> reads, int min_len) const {
+	std::vector<std::vector<SMEM>> result(reads.size());
+	for (size_t r=0; r<reads.size(); r++) {
+		smems(reads[r], result[r], min_len);
+	}
+	return result;
+}
+
+void BiFMIndex::save(const std::string& path) const {
+	IndexWriter out(path);
+	fwd.save(out);
+	rev.save(out);
+	out.finish();
+}
+
+BiFMIndex BiFMIndex::load(const std::string& path) {
+	IndexReader in(path);
+	BiFMIndex bi;
+	bi.fwd = FMIndex::load(in);
+	bi.rev = FMIndex::load(in);
+	return bi;
+}
@@ -0,0 +1,79 @@
+#include "ContigTable.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <climits>
+
+ContigTable::ContigTable(const std::vector<std::string>& names, const std::vector<int>& lengths) {
+	if (names.size() != lengths.size()) {
+		throw std::invalid_argument("Contig names and lengths differ in number. ");
+	}
+	std::vector<int> s(names.size());
+	std::vector<uint64_t> offsets(names.size() + 1, 0);
+	std::string data;
+	// starts are int text positions, like the index's
+	int64_t pos = 0;
+	for (size_t i=0; i<names.size(); i++) {
+		if (lengths[i] < 0 || pos + lengths[i] >= INT_MAX) {
+			throw std::invalid_argument("Contigs exceed the index limit of 2^31 - 1 symbols. ");
+		}
+		s[i] = pos;
+		pos += lengths[i] + 1;
+		data += names[i];
+		offsets[i + 1] = data.size();
+	}
+	starts = std::move(s);
+	this->lengths = std::vector<int>(lengths);
+	name_data = std::vector<char>(data.begin(), data.end());
+	name_offsets = std::move(offsets);
+}
+
+void ContigTable::prepend(const ContigTable& front) {
+	if (front.size() == 0) return;
+	std::vector<std::string> names;
+	std::vector<int> all_lengths;
+	for (int i=0; i<front.size(); i++) {
+		names.emplace_back(front.name(i));
+		all_lengths.push_back(front.length(i));
+	}
+	for (int i=0; i<size(); i++) {
+		names.emplace_back(name(i));
+		all_lengths.push_back(length(i));
+	}
+	// laid out again, one separator between neighbours puts the old contigs
+	// right after the front's trailing one
+	*this = ContigTable(names, all_lengths);
+}
+
+int ContigTable::find(int pos) const {
+	// last contig starting at or before pos
+	auto it = std::upper_bound(starts.begin(), starts.end(), pos);
+	if (it == starts.begin()) return -1;
+	int id = it - starts.begin() - 1;
+	return pos < starts[id] + lengths[id] ? id : -1;
+}
+
+bool ContigTable::resolve(int pos, int len, int& contig, int& offset) const {
+	contig = find(pos);
+	if (contig < 0) return false;
+	offset = pos - starts[contig];
+	return offset + len <= lengths[contig];
+}
+
+void ContigTable::save(IndexWriter& out) const {
+	out.write(starts);
+	out.write(lengths);
+	out.write(name_data);
+	out.write(name_offsets);
+}
+
+void ContigTable::load(IndexReader& in) {
+	starts = in.next<int>();
+	lengths = in.next<int>();
+	name_data = in.next<char>();
+	name_offsets = in.next<uint64_t>();
+	if (lengths.size() != starts.size() || name_offsets.size() != starts.size() + 1
+		|| name_offsets.back() != name_data.size()) {
+		throw std::runtime_error("Corrupt index file: contig table. ");
+	}
+	mapping = in.mapping();
+}
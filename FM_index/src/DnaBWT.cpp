@@ -0,0 +1,48 @@
+#include "DnaBWT.hpp"
+
+void DnaBWT::buildCounts(int threads) {
+	// running packed-slot counts, one checkpoint per block: each thread totals
+	// its run of blocks, then fills them in starting from the runs before it
+	threads = std::max(threads, 1);
+	RankBlock* first = blocks.mutableData();
+	std::vector<std::array<uint32_t, 4>> part_total(threads + 1, {0, 0, 0, 0});
+	auto blockCounts = [&](const RankBlock& b, int c) {
+		uint32_t r = 0;
+		for (uint64_t w : b.bits) r += std::popcount(matchMask(w, c));
+		return r;
+	};
+	parallelFor(threads, blocks.size(), [&](int t, size_t begin, size_t end) {
+		for (size_t k=begin; k<end; k++) {
+			for (int c=0; c<4; c++) part_total[t + 1][c] += blockCounts(first[k], c);
+		}
+	});
+	for (int t=0; t<threads; t++) {
+		for (int c=0; c<4; c++) part_total[t + 1][c] += part_total[t][c];
+	}
+	parallelFor(threads, blocks.size(), [&](int t, size_t begin, size_t end) {
+		std::array<uint32_t, 4> total = part_total[t];
+		for (size_t k=begin; k<end; k++) {
+			for (int c=0; c<4; c++) {
+				first[k].count[c] = total[c];
+				total[c] += blockCounts(first[k], c);
+			}
+		}
+	});
+}
+
+void DnaBWT::save(IndexWriter& out) const {
+	out.writeValue(n);
+	out.writeValue(dollar);
+	out.write(blocks);
+	out.write(n_runs);
+}
+
+void DnaBWT::load(IndexReader& in) {
+	n = in.nextValue<int>();
+	dollar = in.nextValue<int>();
+	blocks = in.next<RankBlock>();
+	n_runs = in.next<Run>();
+	if (blocks.size() != size_t(n / SYMBOLS_PER_BLOCK + 1)) {
+		throw std::runtime_error("Corrupt index file: rank block count does not match the BWT length. ");
+	}
+}
@@ -0,0 +1,319 @@
+#include "FM_Index.hpp"
+#include "SAIS.hpp"
+#include <fstream>
+#include <filesystem>
+#include <climits>
+#include <string_view>
+#include <unistd.h>
+
+namespace {
+
+// block working set per symbol: text, R, keys and their sorted copy, the
+// integer string and its suffix array
+constexpr size_t BLOCK_BYTES_PER_SYMBOL = 32;
+constexpr size_t MIN_BLOCK = 1 << 16;
+// one-byte-per-row spill files are streamed through buffers this large
+constexpr size_t IO_BUFFER = 1 << 20;
+
+// removes the spill files however the build ends
+struct SpillFiles {
+	std::string path[2];
+	~SpillFiles() {
+		std::error_code ec;
+		for (auto& p : path) std::filesystem::remove(p, ec);
+	}
+};
+
+// text[offset, offset + len), '$' only allowed as the last symbol of the text
+void readBlock(std::ifstream& in, size_t offset, size_t len, bool text_end, std::string& out) {
+	out.resize(len);
+	in.seekg(offset);
+	if (!in.read(out.data(), len)) {
+		throw std::runtime_error("Cannot read index text. ");
+	}
+	for (size_t i=0; i<len; i++) {
+		if (out[i] == '$' && !(text_end && i + 1 == len)) {
+			throw std::invalid_argument("\"$\" must only appear at the end. ");
+		}
+	}
+}
+
+// rank structure over a spilled BWT, one symbol per byte; read through a
+// buffer rather than mapped so the file never counts towards the budget,
+// which relies on a single-threaded build() asking for rows in order
+DnaBWT loadBWT(const std::string& path, int len) {
+	std::ifstream in(path, std::ios::binary);
+	std::vector<char> buffer(IO_BUFFER);
+	int first = 0, filled = 0;
+	DnaBWT bwt;
+	bwt.build(len, [&](int i) {
+		if (i >= first + filled) {
+			first = i;
+			filled = std::min<int>(buffer.size(), len - i);
+			if (!in.read(buffer.data(), filled)) {
+				throw std::runtime_error("Cannot read BWT spill file " + path);
+			}
+		}
+		return buffer[i - first];
+	});
+	bwt.buildCounts();
+	return bwt;
+}
+
+// R[j], j in [0, L]: old suffixes smaller than suffix j of block followed by
+// the old text, by backward search from the old text's first suffix, which
+// sits at the old '$' row; returns that row
+int blockRanks(const DnaBWT& old, std::string_view block, std::vector<int>& R) {
+	const int old_n = old.size();
+	const int L = block.size();
+	std::array<int, DNA_SIGMA> C_old{};
+	int total = 0;
+	for (int c : DNA_LEX_ORDER) {
+		C_old[c] = total;
+		total += old.rank(c, old_n);
+	}
+	R.resize(L + 1);
+	R[L] = old.dollarRow();
+	for (int j=L-1; j>=0; j--) {
+		int c = dnaCode(block[j]);
+		if (c < 0) {
+			throw std::invalid_argument("Unsupported symbol, the DNA index takes A/C/G/T/N and \"$\". ");
+		}
+		R[j] = C_old[c] + old.rank(c, R[j + 1]);
+	}
+	return R[L];
+}
+
+// the block's suffixes in order, SA entries L and above are to be skipped.
+// (R, first symbol) orders new suffixes wherever it differs, and the old
+// text's first suffix, which continues every one of them, sorts above exactly
+// those with R <= r_s; so the block sorts as the suffixes of these ranked keys
+void sortBlock(std::string_view block, const std::vector<int>& R, int r_s, std::vector<int>& SA) {
+	const int L = block.size();
+	std::vector<uint64_t> keys(L + 1);
+	for (int j=0; j<L; j++) keys[j] = uint64_t(R[j]) << 3 | dnaLexRank(dnaCode(block[j]));
+	keys[L] = uint64_t(r_s) << 3 | 7;
+	std::vector<uint64_t> sorted = keys;
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+	std::vector<int> K(L + 2);
+	for (int j=0; j<=L; j++) K[j] = 1 + (std::lower_bound(sorted.begin(), sorted.end(), keys[j]) - sorted.begin());
+	K[L + 1] = 0;
+	keys = std::vector<uint64_t>();
+	int symbols = sorted.size();
+	sorted = std::vector<uint64_t>();
+	buildSuffixArray(K, SA, symbols);
+}
+
+}
+
+FMIndex FMIndex::buildExternal(const std::string& text_path, size_t memory_budget,
+	const std::string& tmp_dir, const FMIndexOptions& opt) {
+	if (opt.sa_sample_rate < 1) {
+		throw std::invalid_argument("SA sample rate must be at least 1. ");
+	}
+	if (opt.backend != RankBackend::Dna) {
+		throw std::invalid_argument("External construction needs the DNA rank backend. ");
+	}
+	std::ifstream text(text_path, std::ios::binary);
+	if (!text) {
+		throw std::runtime_error("Cannot open index text: " + text_path);
+	}
+	text.seekg(0, std::ios::end);
+	const size_t n = text.tellg();
+	if (n == 0 || n > size_t(INT_MAX)) {
+		throw std::invalid_argument("Index text must hold 1 to 2^31 - 1 symbols. ");
+	}
+
+	// the rank structure of the BWT so far and the final SA samples stay
+	// resident, the rest of the budget goes to the block being merged
+	size_t resident = n / 3 + n / opt.sa_sample_rate * 8;
+	size_t block = memory_budget > resident ? (memory_budget - resident) / BLOCK_BYTES_PER_SYMBOL : 0;
+	block = std::min(n, std::max(block, MIN_BLOCK));
+
+	SpillFiles spill;
+	for (int k=0; k<2; k++) {
+		spill.path[k] = tmp_dir + "/fmindex-" + std::to_string(getpid()) + "-" + std::to_string(k) + ".bwt";
+	}
+	int cur = 0;
+
+	// the last block holds '$' and is sorted on its own
+	size_t s = n - block;
+	std::string chunk;
+	readBlock(text, s, block, true, chunk);
+	if (chunk.back() != '$') {
+		throw std::invalid_argument("Must have \"$\" at the end. ");
+	}
+	std::vector<int> SA;
+	buildSuffixArray(chunk, SA);
+	{
+		std::ofstream out(spill.path[cur], std::ios::binary);
+		for (int k : SA) out.put(chunk[k > 0 ? k - 1 : block - 1]);
+		if (!out) throw std::runtime_error("Cannot write " + spill.path[cur]);
+	}
+	size_t old_n = block;
+
+	// BWT of T[s..n) on disk; the row of suffix s holds '$' in place of T[s-1]
+	std::vector<int> R;
+	while (s > 0) {
+		size_t b = s > block ? s - block : 0;
+		const int L = s - b;
+		readBlock(text, b, L, false, chunk);
+		int r_s;
+		{
+			DnaBWT old = loadBWT(spill.path[cur], old_n);
+			r_s = blockRanks(old, chunk, R);
+		}
+		sortBlock(chunk, R, r_s, SA);
+
+		// merge: each new suffix goes in front of old row R, and the old '$'
+		// row takes its real symbol, the last one of the block
+		{
+			std::ifstream in(spill.path[cur], std::ios::binary);
+			std::ofstream out(spill.path[1 - cur], std::ios::binary);
+			std::vector<char> buffer(IO_BUFFER);
+			size_t row = 0;
+			auto copyOld = [&](size_t upto) {
+				while (row < upto) {
+					size_t len = std::min(upto - row, buffer.size());
+					in.read(buffer.data(), len);
+					if (row <= size_t(r_s) && size_t(r_s) < row + len) buffer[r_s - row] = chunk[L - 1];
+					out.write(buffer.data(), len);
+					row += len;
+				}
+			};
+			for (int k : SA) {
+				if (k >= L) continue;
+				copyOld(R[k]);
+				out.put(k > 0 ? chunk[k - 1] : '$');
+			}
+			copyOld(old_n);
+			if (!in || !out) throw std::runtime_error("Cannot merge BWT spill files in " + tmp_dir);
+		}
+		cur = 1 - cur;
+		old_n += L;
+		s = b;
+	}
+	R = std::vector<int>();
+	SA = std::vector<int>();
+
+	FMIndex fm;
+	fm.sa_rate = opt.sa_sample_rate;
+	fm.bwt = loadBWT(spill.path[cur], n);
+	fm.buildC();
+	// SA samples by walking LF through the whole text from the '$' suffix,
+	// which is row 0
+	std::vector<std::pair<int, int>> samples;
+	samples.reserve(n / fm.sa_rate + 1);
+	int row = 0;
+	for (int pos=n-1; pos>=0; pos--) {
+		if (pos % fm.sa_rate == 0) samples.push_back({row, pos});
+		if (pos > 0) row = fm.LF(row);
+	}
+	std::sort(samples.begin(), samples.end());
+	fm.sa_sampled = BitVector(n);
+	Storage<int> positions(samples.size(), 0), rows(samples.size(), 0);
+	fm.isa_sampled = BitVector(n);
+	for (size_t k=0; k<samples.size(); k++) {
+		fm.sa_sampled.set(samples[k].first);
+		positions.mutableData()[k] = samples[k].second;
+		fm.isa_sampled.set(samples[k].second);
+		rows.mutableData()[samples[k].second / fm.sa_rate] = samples[k].first;
+	}
+	fm.sa_sampled.buildRank();
+	fm.isa_sampled.buildRank();
+	fm.sa_samples = std::move(positions);
+	fm.isa_samples = std::move(rows);
+	fm.buildKmerTable(opt.kmer_length);
+	return fm;
+}
+
+void FMIndex::add(std::string_view sequences) {
+	if (backend != RankBackend::Dna) {
+		throw std::invalid_argument("Adding sequences needs the DNA rank backend. ");
+	}
+	if (sequences.find('$') != std::string_view::npos) {
+		throw std::invalid_argument("\"$\" must only appear at the end. ");
+	}
+	if (sequences.empty()) return;
+	const int n = bwt.size();
+	if (size_t(n) + sequences.size() > size_t(INT_MAX)) {
+		throw std::invalid_argument("Index text must hold 1 to 2^31 - 1 symbols. ");
+	}
+	const int L = sequences.size();
+	// the new sequences sort against the unchanged old suffixes as one more
+	// block of the external build
+	std::vector<int> R, SA;
+	const int r_s = blockRanks(bwt, sequences, R);
+	sortBlock(sequences, R, r_s, SA);
+
+	// merged rows in order: each new suffix k goes in front of old row R[k];
+	// returns k, or -1 - row for the next old row
+	size_t next = 0;
+	int old_row = 0;
+	auto step = [&]() {
+		while (next < SA.size() && SA[next] >= L) next++;
+		if (next < SA.size() && R[SA[next]] == old_row) return SA[next++];
+		return -1 - old_row++;
+	};
+	// old rows keep their symbol except the old '$' row, which now follows
+	// the last new symbol; rows are asked for in order by a single thread
+	DnaBWT merged;
+	merged.build(n + L, [&](int) {
+		int k = step();
+		if (k >= 0) return k > 0 ? sequences[k - 1] : '$';
+		int row = -1 - k;
+		return row == r_s ? sequences[L - 1] : bwt[row];
+	});
+	merged.buildCounts(build_threads);
+
+	// old samples move up by L, new suffixes are sampled at multiples of the
+	// rate; either way no row is more than sa_rate - 1 LF steps from a sample
+	const int new_samples = (L + sa_rate - 1) / sa_rate;
+	BitVector sampled(n + L);
+	Storage<int> positions(sa_samples.size() + new_samples, 0);
+	Storage<int> rows(positions.size(), 0);
+	int* out = positions.mutableData();
+	int* isa = rows.mutableData();
+	next = 0;
+	old_row = 0;
+	for (int i=0; i<n+L; i++) {
+		int k = step();
+		if (k >= 0) {
+			if (k % sa_rate != 0) continue;
+			*out++ = k;
+			isa[k / sa_rate] = i;
+		} else {
+			int row = -1 - k;
+			if (!sa_sampled.get(row)) continue;
+			*out++ = sa_samples[sa_sampled.rank(row)] + L;
+		}
+		sampled.set(i);
+	}
+	sampled.buildRank();
+	// inverse samples: the new positions come first, then the old ones, each
+	// old row moved down by the new suffixes merged in front of it
+	std::vector<int> inserted;
+	inserted.reserve(L);
+	for (int k : SA) {
+		if (k < L) inserted.push_back(R[k]);
+	}
+	BitVector isa_merged(n + L);
+	for (int k=0; k<L; k+=sa_rate) isa_merged.set(k);
+	for (size_t j=0; j<isa_samples.size(); j++) {
+		int row = isa_samples[j];
+		isa[new_samples + j] = row + (std::upper_bound(inserted.begin(), inserted.end(), row) - inserted.begin());
+	}
+	for (int pos=isa_sampled.next(0); pos<n; pos=isa_sampled.next(pos + 1)) isa_merged.set(pos + L);
+	isa_merged.buildRank();
+
+	bwt = std::move(merged);
+	sa_sampled = std::move(sampled);
+	sa_samples = std::move(positions);
+	isa_sampled = std::move(isa_merged);
+	isa_samples = std::move(rows);
+	buildC();
+	buildKmerTable(kmer_k);
+	// nothing points into the file any more
+	mapping.reset();
+}
@@ -1,89 +1,417 @@
 #include "FM_Index.hpp"
+#include "SAIS.hpp"
+#include "ParallelSA.hpp"
+#include "Parallel.hpp"
+#include <climits>
+
+FMIndex FMIndex::buildReverse(const std::string& T) {
+	if (T.empty() || T.back() != '$') {
+		throw std::invalid_argument("Must have \"$\" at the end. ");
+	}
+	std::string R(T.rbegin() + 1, T.rend());
+	R.push_back('$');
+	FMIndexOptions opt;
+	opt.sa_sample_rate = INT_MAX;
+	return FMIndex(R, opt);
+}
 
 void FMIndex::buildBWT(const std::string& T) {
 	// check if '$' at the end
-	if (T.find('$') == std::string::npos) {
+	if (T.empty() || T.back() != '$') {
 		throw std::invalid_argument("Must have \"$\" at the end. ");
 	}
-	// store the rotation case for string
-	const int n = T.size();
-	std::vector<std::string> rotations;
-	for (int i=0; i<n; i ++) {
-		rotations.push_back(T.substr(i) + T.substr(0, i));
+	if (T.find('$') != T.size() - 1) {
+		throw std::invalid_argument("\"$\" must only appear at the end. ");
 	}
-	// sort the rotation list
-	std::sort(rotations.begin(), rotations.end());
-	// initialize
-	bwt = "";
-	suffix_array.clear();
-	// store the bwt
-	for (int i=0; i<n; i++) {
-		bwt += rotations[i][n-1];
-		suffix_array.push_back((n - rotations[i].find('$')) % n);
+	// suffix arrays and ranks are int
+	if (T.size() > size_t(INT_MAX)) {
+		throw std::invalid_argument("Index text must hold 1 to 2^31 - 1 symbols. ");
+	}
+	// sort the suffixes, '$' is the unique smallest symbol
+	const int n = T.size();
+	std::vector<int> suffix_array;
+	auto bwtAt = [&](int i) { return T[suffix_array[i] > 0 ? suffix_array[i] - 1 : n - 1]; };
+	if (backend == RankBackend::Wavelet) {
+		// codes in byte order after '$', the order SA-IS sorts bytes in
+		bool present[256] = {};
+		for (unsigned char ch : T) present[ch] = true;
+		alphabet.assign(1, '$');
+		for (int ch=0; ch<256; ch++) {
+			if (present[ch] && ch != '$') alphabet.push_back(char(ch));
+		}
+		codes.fill(-1);
+		for (size_t c=0; c<alphabet.size(); c++) codes[static_cast<unsigned char>(alphabet[c])] = c;
+
+		buildSuffixArray(T, suffix_array);
+		std::vector<uint8_t> symbols(n);
+		for (int i=0; i<n; i++) symbols[i] = codes[static_cast<unsigned char>(bwtAt(i))];
+		wavelet.build(symbols, alphabet.size());
+	} else {
+		if (build_threads > 1) buildSuffixArrayParallel(T, suffix_array, build_threads);
+		else buildSuffixArray(T, suffix_array);
+		// store the bwt, the symbol preceding each suffix, packed at 2 bits
+		bwt.build(n, bwtAt, build_threads);
 	}
+	sampleSA(suffix_array);
+}
+
+std::array<int16_t, 256> FMIndex::dnaCodes() {
+	std::array<int16_t, 256> table;
+	for (int ch=0; ch<256; ch++) table[ch] = dnaCode(char(ch));
+	return table;
+}
+
+void FMIndex::sampleSA(const std::vector<int>& suffix_array) {
+	// keep the rows whose text position is a multiple of the rate,
+	// position 0 is always kept so every LF walk terminates
+	const int n = suffix_array.size();
+	sa_sampled = BitVector(n);
+	// count the samples of each run of rows first, so every thread knows where
+	// its samples go; runs start on a word boundary of the bit vector
+	std::vector<int> part_start(build_threads + 1, 0);
+	parallelFor(build_threads, n, [&](int t, size_t begin, size_t end) {
+		for (size_t i=begin; i<end; i++) {
+			if (suffix_array[i] % sa_rate == 0) part_start[t + 1]++;
+		}
+	}, 64);
+	for (int t=0; t<build_threads; t++) part_start[t + 1] += part_start[t];
+	Storage<int> samples(part_start.back(), 0);
+	Storage<int> rows(part_start.back(), 0);
+	int* out = samples.mutableData();
+	int* isa = rows.mutableData();
+	parallelFor(build_threads, n, [&](int t, size_t begin, size_t end) {
+		int k = part_start[t];
+		for (size_t i=begin; i<end; i++) {
+			if (suffix_array[i] % sa_rate == 0) {
+				sa_sampled.set(i);
+				out[k++] = suffix_array[i];
+				isa[suffix_array[i] / sa_rate] = i;
+			}
+		}
+	}, 64);
+	sa_sampled.buildRank();
+	// the same positions again, bits set here since they are not in row order
+	isa_sampled = BitVector(n);
+	for (int pos=0; pos<n; pos+=sa_rate) isa_sampled.set(pos);
+	isa_sampled.buildRank();
+	isa_samples = std::move(rows);
+	sa_samples = std::move(samples);
 }
 
 void FMIndex::buildC() {
-	std::string sorted_bwt = bwt;
-	sort(sorted_bwt.begin(), sorted_bwt.end());
-	
-	std::unordered_map<char, int> count;
-	for (char c : sorted_bwt) {
-		count[c]++;
-	}
+	// totals come from the last checkpoint, O(sigma) whatever the length
 	int total = 0;
-	for (char c : sorted_bwt) {
-		if (C.count(c) == 0) {
+	if (backend == RankBackend::Wavelet) {
+		const int n = wavelet.size();
+		C.assign(alphabet.size(), 0);
+		for (size_t c=0; c<alphabet.size(); c++) {
 			C[c] = total;
-			total += count[c];
+			total += wavelet.rank(c, n);
 		}
+		return;
+	}
+	const int n = bwt.size();
+	C.assign(DNA_SIGMA, 0);
+	for (int c : DNA_LEX_ORDER) {
+		C[c] = total;
+		total += bwt.rank(c, n);
 	}
 }
 
 void FMIndex::buildOcc() {
-	std::unordered_map<char, int> freq;
-	for (int i = 0; i < bwt.size(); ++i) {
-		for (auto& p : C) {
-			char c = p.first;
-			(i==0) ? Occ[c].push_back(bwt[i]==c ? 1 : 0)
-				   : Occ[c].push_back(Occ[c][i-1] + (bwt[i]==c ? 1 : 0));
+	// checkpoint counts are interleaved with the packed symbols, the wavelet
+	// matrix built its rank samples along with its levels
+	if (backend == RankBackend::Dna) bwt.buildCounts(build_threads);
+}
+
+void FMIndex::buildKmerTable(int k) {
+	if (k < 0 || k > 15) {
+		throw std::invalid_argument("k-mer table length must be between 0 and 15. ");
+	}
+	if (k > 0 && backend != RankBackend::Dna) {
+		throw std::invalid_argument("The k-mer table needs the DNA rank backend. ");
+	}
+	kmer_k = k;
+	if (k == 0) {
+		kmer_table = Storage<SAInterval>();
+		return;
+	}
+	// k-mer s_0..s_{k-1} sits at sum(code(s_j) << 2(k-1-j)); extending a suffix
+	// backwards by one symbol sets the next two higher bits
+	Storage<SAInterval> table(size_t(1) << (2 * k), SAInterval{1, 0});
+	SAInterval* out = table.mutableData();
+	auto extend = [&](auto& self, int depth, size_t code, SAInterval range) -> void {
+		if (depth == k) {
+			out[code] = range;
+			return;
 		}
+		for (int c=0; c<4; c++) {
+			SAInterval next{C[c] + bwt.rank(c, range.sp), C[c] + bwt.rank(c, range.ep + 1) - 1};
+			// every longer k-mer with this suffix is absent too
+			if (!next.empty()) self(self, depth + 1, code | (size_t(c) << (2 * depth)), next);
+		}
+	};
+	extend(extend, 0, 0, SAInterval{0, bwt.size() - 1});
+	kmer_table = std::move(table);
+}
+
+bool FMIndex::kmerStart(std::string_view pattern, SAInterval& range, int& i) const {
+	int m = pattern.size();
+	if (kmer_k == 0 || m < kmer_k) return false;
+	size_t code = 0;
+	for (int j=m-kmer_k; j<m; j++) {
+		int c = dnaCode(pattern[j]);
+		if (c < 0 || c > DNA_T) return false;
+		code = (code << 2) | c;
 	}
+	range = kmer_table[code];
+	i = m - kmer_k - 1;
+	return true;
 }
 
 void FMIndex::print() {
-	std::cout << "BWT: " << bwt << std::endl;
+	const int n = sa_sampled.size();
+	std::cout << "BWT: ";
+	for (int i = 0; i < n; ++i) std::cout << symbolChar(codeAt(i));
+	std::cout << std::endl;
 	std::cout << "C table:\n";
-	for (auto& p : C) {
-		std::cout << "  C(" << p.first << ") = " << p.second << " ";
+	for (size_t c = 0; c < C.size(); ++c) {
+		if (occ(c, n) > 0) std::cout << "  C(" << symbolChar(c) << ") = " << C[c] << " ";
 	}
 	std::cout << std::endl;
 
-	std::cout << "Suffix Array:\n";
-	for (int i = 0; i < suffix_array.size(); ++i) {
-		std::cout << "  SA[" << i << "] = " << suffix_array[i] << std::endl;
+	std::cout << "Suffix Array (sampled every " << sa_rate << "):\n";
+	for (int i = 0; i < n; ++i) {
+		if (sa_sampled.get(i)) {
+			std::cout << "  SA[" << i << "] = " << sa_samples[sa_sampled.rank(i)] << std::endl;
+		}
+	}
+}
+
+void FMIndex::save(const std::string& path) const {
+	IndexWriter out(path);
+	save(out);
+	out.finish();
+}
+
+void FMIndex::save(IndexWriter& out) const {
+	// layout: sample rate, backend, symbol codes, C, BWT + rank structure,
+	// sampled SA and inverse SA, k-mer table
+	out.writeValue(sa_rate);
+	out.writeValue(backend);
+	out.write(codes.data(), codes.size());
+	out.write(alphabet.data(), alphabet.size());
+	out.write(C.data(), C.size());
+	if (backend == RankBackend::Dna) bwt.save(out);
+	else wavelet.save(out);
+	sa_sampled.save(out);
+	out.write(sa_samples);
+	isa_sampled.save(out);
+	out.write(isa_samples);
+	out.writeValue(kmer_k);
+	out.write(kmer_table);
+}
+
+FMIndex FMIndex::load(const std::string& path, bool resident) {
+	IndexReader in(path, resident);
+	return load(in);
+}
+
+FMIndex FMIndex::load(IndexReader& in) {
+	FMIndex fm;
+	fm.sa_rate = in.nextValue<int>();
+	fm.backend = in.nextValue<RankBackend>();
+	Storage<int16_t> code_table = in.next<int16_t>();
+	if (code_table.size() != fm.codes.size()) {
+		throw std::runtime_error("Corrupt index file: symbol code table size. ");
+	}
+	std::copy(code_table.begin(), code_table.end(), fm.codes.begin());
+	Storage<char> alphabet = in.next<char>();
+	fm.alphabet.assign(alphabet.begin(), alphabet.end());
+	Storage<int> c_table = in.next<int>();
+	size_t sigma = fm.backend == RankBackend::Dna ? size_t(DNA_SIGMA) : fm.alphabet.size();
+	if (c_table.size() != sigma) {
+		throw std::runtime_error("Corrupt index file: C table size. ");
+	}
+	fm.C.assign(c_table.begin(), c_table.end());
+	if (fm.backend == RankBackend::Dna) fm.bwt.load(in);
+	else fm.wavelet.load(in);
+	fm.sa_sampled.load(in);
+	fm.sa_samples = in.next<int>();
+	fm.isa_sampled.load(in);
+	fm.isa_samples = in.next<int>();
+	if (fm.isa_sampled.size() != fm.sa_sampled.size() || fm.isa_samples.size() != fm.sa_samples.size()) {
+		throw std::runtime_error("Corrupt index file: inverse SA samples. ");
+	}
+	fm.kmer_k = in.nextValue<int>();
+	fm.kmer_table = in.next<SAInterval>();
+	if (fm.kmer_table.size() != (fm.kmer_k ? size_t(1) << (2 * fm.kmer_k) : 0)) {
+		throw std::runtime_error("Corrupt index file: k-mer table size. ");
+	}
+	fm.mapping = in.mapping();
+	return fm;
+}
+
+int FMIndex::LF(int row) const {
+	int c = codeAt(row);
+	return C[c] + occ(c, row);
+}
+
+int FMIndex::locate(int row) const {
+	// walk backwards through the text until we hit a sampled position,
+	// at most sa_rate - 1 steps
+	int steps = 0;
+	while (!sa_sampled.get(row)) {
+		row = LF(row);
+		steps++;
 	}
+	return sa_samples[sa_sampled.rank(row)] + steps;
+}
+
+std::string FMIndex::extract(int pos, int len) const {
+	const int n = sa_sampled.size();
+	if (pos < 0 || len < 0 || pos > n - len) {
+		throw std::invalid_argument("Extract range lies outside the text. ");
+	}
+	std::string out(len, '\0');
+	extractInto(pos, len, out.data());
+	return out;
+}
+
+void FMIndex::extractInto(int pos, int len, char* out) const {
+	if (len == 0) return;
+	const int n = sa_sampled.size();
+	const int end = pos + len;
+	// the BWT is cyclic, past the last suffix comes suffix 0 again
+	int q = end < n ? isa_sampled.next(end) : n;
+	int row = q < n ? isa_samples[isa_sampled.rank(q)] : isa_samples[0];
+	for (; q>end; q--) row = LF(row);
+	// the row of suffix p holds text[p - 1]
+	for (int p=end-1; p>=pos; p--) {
+		int c = codeAt(row);
+		out[p - pos] = symbolChar(c);
+		row = C[c] + occ(c, row);
+	}
+}
+
+std::string FMIndex::invert(int threads) const {
+	std::string T(sa_sampled.size(), '\0');
+	parallelFor(threads, T.size(), [&](int, size_t begin, size_t end) {
+		extractInto(begin, end - begin, T.data() + begin);
+	});
+	return T;
 }
 
-std::vector<int> FMIndex::query(const std::string& pattern) {
+size_t FMIndex::saBytes() const {
+	return sa_samples.size() * sizeof(int) + sa_sampled.bytes() + isa_samples.size() * sizeof(int) + isa_sampled.bytes();
+}
+
+SAInterval FMIndex::search(std::string_view pattern) const {
 	int m = pattern.size();
-	int sp = 0, ep = bwt.size() - 1;
+	int sp = 0, ep = sa_sampled.size() - 1;
+	int i = m - 1;
+	SAInterval start;
+	if (kmerStart(pattern, start, i)) {
+		if (start.empty()) return {1, 0};
+		sp = start.sp;
+		ep = start.ep;
+	}
 	
-	for (int i=m-1; i>=0; i--) {
-		char c = pattern[i];
-		if (C.count(c) == 0) return {}; // not exist
-		int c_occ_sp = sp > 0 ? Occ[c][sp - 1] : 0;
-		int c_occ_ep = Occ[c][ep];
-
-		sp = C[c] + c_occ_sp;
-		ep = C[c] + c_occ_ep - 1;
-		if (sp > ep) return {};
+	for (; i>=0; i--) {
+		int c = symbolCode(pattern[i]);
+		if (c < 0) return {1, 0}; // not exist
+		// rank() counts [0, i), so sp/ep stay inclusive
+		sp = C[c] + occ(c, sp);
+		ep = C[c] + occ(c, ep + 1) - 1;
+		if (sp > ep) return {1, 0};
 	}
+	return {sp, ep};
+}
 
+std::vector<int> FMIndex::query(const std::string& pattern) const {
+	SAInterval range = search(pattern);
 	// return suffix array
 	std::vector<int> result;
-	for (int i=sp; i<=ep; i++) {
-		result.push_back(suffix_array[i]);
+	result.reserve(range.size());
+	locate(range, std::back_inserter(result));
+	return result;
+}
+
+int FMIndex::locate(std::string_view pattern, std::span<int> buffer) const {
+	SAInterval range = search(pattern);
+	int hits = range.size();
+	int stored = std::min<int>(hits, buffer.size());
+	locate(SAInterval{range.sp, range.sp + stored - 1}, buffer.begin());
+	return hits;
+}
+
+void FMIndex::search_batch(std::span<const std::string> patterns, std::span<SAInterval> out, int group) const {
+	// one lane per in-flight pattern, refilled as soon as a pattern finishes
+	struct Lane {
+		size_t id;
+		int i;
+		int sp, ep;
+	};
+	const int n = sa_sampled.size();
+	std::vector<Lane> lanes;
+	size_t next = 0;
+	auto refill = [&]() {
+		while (lanes.size() < size_t(std::max(group, 1)) && next < patterns.size()) {
+			size_t id = next++;
+			int i = patterns[id].size() - 1;
+			SAInterval range{0, n - 1};
+			kmerStart(patterns[id], range, i);
+			if (i < 0 || range.empty()) {
+				out[id] = range;
+				continue;
+			}
+			// a new lane's first step is on the next round, like every other
+			if (backend == RankBackend::Dna) {
+				bwt.prefetch(range.sp);
+				bwt.prefetch(range.ep + 1);
+			}
+			lanes.push_back({id, i, range.sp, range.ep});
+		}
+	};
+
+	refill();
+	while (!lanes.empty()) {
+		for (size_t k=0; k<lanes.size(); ) {
+			Lane& l = lanes[k];
+			// this step's blocks were prefetched on the previous round, or by
+			// refill() for a new lane
+			int c = symbolCode(patterns[l.id][l.i]);
+			if (c < 0) {
+				l.sp = 1;
+				l.ep = 0;
+			} else {
+				l.sp = C[c] + occ(c, l.sp);
+				l.ep = C[c] + occ(c, l.ep + 1) - 1;
+			}
+			if (l.sp > l.ep || --l.i < 0) {
+				out[l.id] = {l.sp, l.ep};
+				l = lanes.back();
+				lanes.pop_back();
+				continue;
+			}
+			if (backend == RankBackend::Dna) {
+				bwt.prefetch(l.sp);
+				bwt.prefetch(l.ep + 1);
+			}
+			k++;
+		}
+		refill();
+	}
+}
+
+std::vector<std::vector<int>> FMIndex::query_batch(std::span<const std::string> patterns, int group) const {
+	std::vector<SAInterval> ranges(patterns.size());
+	search_batch(patterns, ranges, group);
+
+	std::vector<std::vector<int>> result(patterns.size());
+	for (size_t p=0; p<patterns.size(); p++) {
+		result[p].reserve(ranges[p].size());
+		locate(ranges[p], std::back_inserter(result[p]));
 	}
 	return result;
-}
\ No newline at end of file
+}
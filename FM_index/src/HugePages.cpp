@@ -0,0 +1,100 @@
+#include "HugePages.hpp"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <sys/mman.h>
+
+namespace {
+
+enum Kind { HUGETLB, TRANSPARENT, SYSTEM, NORMAL };
+
+std::atomic<HugePageMode> current_mode{HugePageMode::System};
+std::mutex registry_lock;
+// mapped allocations and how they were backed, for the stats
+std::unordered_map<void*, Kind> registry;
+size_t mapped_bytes[4] = {};
+
+constexpr std::align_val_t SMALL_ALIGN{64};
+
+size_t roundUp(size_t bytes) {
+	return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+void record(void* p, size_t len, Kind kind) {
+	std::lock_guard<std::mutex> guard(registry_lock);
+	registry[p] = kind;
+	mapped_bytes[kind] += len;
+}
+
+// anonymous mapping starting on a 2 MB boundary, so every 2 MB of it can
+// become one hugepage
+void* alignedMapping(size_t len) {
+	size_t over = len + HUGE_PAGE_SIZE;
+	void* raw = mmap(nullptr, over, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) throw std::bad_alloc();
+	uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+	uintptr_t start = (begin + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	if (start > begin) munmap(raw, start - begin);
+	size_t tail = begin + over - (start + len);
+	if (tail > 0) munmap(reinterpret_cast<void*>(start + len), tail);
+	return reinterpret_cast<void*>(start);
+}
+
+}
+
+void setHugePageMode(HugePageMode mode) {
+	current_mode = mode;
+}
+
+HugePageMode hugePageMode() {
+	return current_mode;
+}
+
+HugePageStats hugePageStats() {
+	std::lock_guard<std::mutex> guard(registry_lock);
+	return {mapped_bytes[HUGETLB], mapped_bytes[TRANSPARENT], mapped_bytes[SYSTEM], mapped_bytes[NORMAL]};
+}
+
+void* allocateIndexMemory(size_t bytes) {
+	if (bytes < HUGE_PAGE_SIZE) return ::operator new(bytes, SMALL_ALIGN);
+	const size_t len = roundUp(bytes);
+	HugePageMode mode = current_mode;
+	if (mode == HugePageMode::Explicit) {
+		void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			record(p, len, HUGETLB);
+			return p;
+		}
+	}
+	void* p = alignedMapping(len);
+	// the advice is only a hint, a kernel without THP keeps normal pages
+	if (mode == HugePageMode::System) {
+		record(p, len, SYSTEM);
+	} else if (mode == HugePageMode::ForceOff) {
+		madvise(p, len, MADV_NOHUGEPAGE);
+		record(p, len, NORMAL);
+	} else {
+		madvise(p, len, MADV_HUGEPAGE);
+		record(p, len, TRANSPARENT);
+	}
+	return p;
+}
+
+void freeIndexMemory(void* p, size_t bytes) {
+	if (!p) return;
+	if (bytes < HUGE_PAGE_SIZE) {
+		::operator delete(p, SMALL_ALIGN);
+		return;
+	}
+	const size_t len = roundUp(bytes);
+	{
+		std::lock_guard<std::mutex> guard(registry_lock);
+		auto it = registry.find(p);
+		if (it != registry.end()) {
+			mapped_bytes[it->second] -= len;
+			registry.erase(it);
+		}
+	}
+	munmap(p, len);
+}
@@ -0,0 +1,103 @@
+#include "IndexFile.hpp"
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char INDEX_MAGIC[8] = {'F', 'M', 'I', 'N', 'D', 'E', 'X', '\0'};
+
+IndexWriter::IndexWriter(const std::string& path) : path(path), out(path, std::ios::binary | std::ios::trunc) {
+	if (!out) {
+		throw std::runtime_error("Cannot open index file for writing: " + path);
+	}
+	// placeholder, patched by finish()
+	IndexFileHeader header{};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+size_t IndexWriter::align() {
+	// pad so every section starts on a cache line
+	static const char zeros[INDEX_SECTION_ALIGN] = {};
+	size_t pos = out.tellp();
+	size_t pad = (INDEX_SECTION_ALIGN - pos % INDEX_SECTION_ALIGN) % INDEX_SECTION_ALIGN;
+	out.write(zeros, pad);
+	return pos + pad;
+}
+
+void IndexWriter::writeSection(const void* data, size_t bytes) {
+	table.push_back({align(), bytes});
+	out.write(static_cast<const char*>(data), bytes);
+}
+
+void IndexWriter::finish() {
+	IndexFileHeader header{};
+	std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	header.version = INDEX_FILE_VERSION;
+	header.byte_order = INDEX_BYTE_ORDER;
+	header.table_offset = align();
+	header.section_count = table.size();
+	out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(IndexSection));
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.flush();
+	if (!out) {
+		throw std::runtime_error("Failed writing index file: " + path);
+	}
+}
+
+MappedFile::MappedFile(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Cannot open index file: " + path);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::runtime_error("Cannot stat index file: " + path);
+	}
+	len = st.st_size;
+	// shared mapping: every process serving this file uses the same page cache
+	void* p = len > 0 ? mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (p == MAP_FAILED) {
+		throw std::runtime_error("Cannot map index file: " + path);
+	}
+	base = static_cast<const uint8_t*>(p);
+}
+
+MappedFile::~MappedFile() {
+	if (base) munmap(const_cast<uint8_t*>(base), len);
+}
+
+IndexReader::IndexReader(const std::string& path, bool resident) : file(std::make_shared<MappedFile>(path)), resident(resident) {
+	if (file->size() < sizeof(IndexFileHeader)) {
+		throw std::runtime_error("Not an FM index file: " + path);
+	}
+	const auto* header = reinterpret_cast<const IndexFileHeader*>(file->data());
+	if (std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+		throw std::runtime_error("Not an FM index file: " + path);
+	}
+	if (header->byte_order != INDEX_BYTE_ORDER) {
+		throw std::runtime_error("Index file was written with a different byte order: " + path);
+	}
+	if (header->version != INDEX_FILE_VERSION) {
+		throw std::runtime_error("Unsupported index file version " + std::to_string(header->version) + ": " + path);
+	}
+	if (header->table_offset + header->section_count * sizeof(IndexSection) > file->size()) {
+		throw std::runtime_error("Corrupt index file: truncated section table. ");
+	}
+	table = reinterpret_cast<const IndexSection*>(file->data() + header->table_offset);
+	section_count = header->section_count;
+}
+
+const IndexSection& IndexReader::nextSection() {
+	if (cursor >= section_count) {
+		throw std::runtime_error("Corrupt index file: missing section. ");
+	}
+	const IndexSection& s = table[cursor++];
+	if (s.offset + s.bytes > file->size()) {
+		throw std::runtime_error("Corrupt index file: section out of bounds. ");
+	}
+	return s;
+}
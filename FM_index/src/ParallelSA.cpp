@@ -0,0 +1,128 @@
+#include "ParallelSA.hpp"
+#include "Parallel.hpp"
+#include "DnaBWT.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+// symbols in the bucket key of the first round, 3 bits each
+static constexpr int KEY_SYMBOLS = 6;
+static constexpr int BUCKETS = 1 << (3 * KEY_SYMBOLS);
+
+// first KEY_SYMBOLS ranks of the suffix at i, padded with the rank of '$';
+// '$' is unique and last, so only equal suffixes share a padded key
+static uint32_t bucketKey(const std::string& T, int i) {
+	const int n = T.size();
+	uint32_t key = 0;
+	for (int j=0; j<KEY_SYMBOLS; j++) {
+		int r = i + j < n ? dnaLexRank(dnaCode(T[i + j])) : 0;
+		if (r < 0) {
+			throw std::invalid_argument("Unsupported symbol, the DNA index takes A/C/G/T/N and \"$\". ");
+		}
+		key = (key << 3) | r;
+	}
+	return key;
+}
+
+// SA entries of a group are flagged while the group is re-sorted: a flag
+// marks the first suffix of a new, smaller group
+static constexpr uint32_t HEAD = 0x80000000u;
+
+void buildSuffixArrayParallel(const std::string& T, std::vector<int>& SA, int threads) {
+	const int n = T.size();
+	threads = std::max(threads, 1);
+	SA.resize(n);
+	if (n == 0) return;
+	// rank[i]: index of the first SA row of the group holding suffix i, so
+	// comparing ranks compares the first h symbols of two suffixes
+	std::vector<int> rank(n);
+
+	// counting sort by bucket key, one histogram per thread so the scatter is
+	// stable and needs no atomics
+	std::vector<int> hist(size_t(threads) * BUCKETS, 0);
+	parallelFor(threads, n, [&](int t, size_t begin, size_t end) {
+		int* h = hist.data() + size_t(t) * BUCKETS;
+		for (size_t i=begin; i<end; i++) h[bucketKey(T, i)]++;
+	});
+	std::vector<int> bucket_start(BUCKETS + 1);
+	int total = 0;
+	for (int k=0; k<BUCKETS; k++) {
+		bucket_start[k] = total;
+		for (int t=0; t<threads; t++) {
+			int count = hist[size_t(t) * BUCKETS + k];
+			hist[size_t(t) * BUCKETS + k] = total;
+			total += count;
+		}
+	}
+	bucket_start[BUCKETS] = total;
+	parallelFor(threads, n, [&](int t, size_t begin, size_t end) {
+		int* offset = hist.data() + size_t(t) * BUCKETS;
+		for (size_t i=begin; i<end; i++) {
+			uint32_t key = bucketKey(T, i);
+			SA[offset[key]++] = i;
+			rank[i] = bucket_start[key];
+		}
+	});
+	hist = std::vector<int>();
+
+	// groups of rows whose suffixes are not told apart yet, [sp, ep)
+	struct Group {
+		int sp, ep;
+	};
+	std::vector<Group> groups;
+	for (int k=0; k<BUCKETS; k++) {
+		if (bucket_start[k + 1] - bucket_start[k] > 1) groups.push_back({bucket_start[k], bucket_start[k + 1]});
+	}
+
+	uint32_t* sa = reinterpret_cast<uint32_t*>(SA.data());
+	for (int h=KEY_SYMBOLS; !groups.empty(); h*=2) {
+		// give each thread a run of groups holding about the same number of rows
+		std::vector<size_t> before(groups.size() + 1, 0);
+		for (size_t g=0; g<groups.size(); g++) before[g + 1] = before[g] + groups[g].ep - groups[g].sp;
+		auto groupsOf = [&](size_t begin, size_t end) {
+			size_t first = std::lower_bound(before.begin(), before.end() - 1, begin) - before.begin();
+			size_t last = std::lower_bound(before.begin(), before.end() - 1, end) - before.begin();
+			return std::make_pair(first, last);
+		};
+
+		// sort each group by the rank h symbols on; ranks are only read here,
+		// so every group sees the ranks of the previous round
+		parallelFor(threads, before.back(), [&](int, size_t begin, size_t end) {
+			auto [first, last] = groupsOf(begin, end);
+			std::vector<uint64_t> keys;
+			for (size_t g=first; g<last; g++) {
+				const Group& grp = groups[g];
+				keys.clear();
+				// every suffix in a group is longer than h, shorter ones hold '$'
+				// within their first h symbols and are unique
+				for (int j=grp.sp; j<grp.ep; j++) keys.push_back(uint64_t(rank[sa[j] + h]) << 32 | sa[j]);
+				std::sort(keys.begin(), keys.end());
+				for (int j=grp.sp; j<grp.ep; j++) {
+					uint64_t k = keys[j - grp.sp];
+					bool head = j == grp.sp || (k >> 32) != (keys[j - grp.sp - 1] >> 32);
+					sa[j] = uint32_t(k) | (head ? HEAD : 0);
+				}
+			}
+		});
+
+		// new ranks from the flagged heads, groups still holding ties go on
+		std::vector<std::vector<Group>> next(threads);
+		parallelFor(threads, before.back(), [&](int t, size_t begin, size_t end) {
+			auto [first, last] = groupsOf(begin, end);
+			for (size_t g=first; g<last; g++) {
+				int head = groups[g].sp;
+				for (int j=groups[g].sp; j<groups[g].ep; j++) {
+					if (sa[j] & HEAD) {
+						if (j - head > 1) next[t].push_back({head, j});
+						head = j;
+						sa[j] &= ~HEAD;
+					}
+					rank[sa[j]] = head;
+				}
+				if (groups[g].ep - head > 1) next[t].push_back({head, groups[g].ep});
+			}
+		});
+		groups.clear();
+		for (auto& part : next) groups.insert(groups.end(), part.begin(), part.end());
+	}
+}
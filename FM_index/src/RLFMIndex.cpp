@@ -0,0 +1,182 @@
+#include "RLFMIndex.hpp"
+#include "SAIS.hpp"
+
+RLFMIndex::RLFMIndex(const std::string& T) {
+	if (T.empty() || T.back() != '$') {
+		throw std::invalid_argument("Must have \"$\" at the end. ");
+	}
+	if (T.find('$') != T.size() - 1) {
+		throw std::invalid_argument("\"$\" must only appear at the end. ");
+	}
+	n = T.size();
+	std::vector<int> SA;
+	buildSuffixArray(T, SA);
+
+	// one pass over the BWT, recording each run as it starts
+	std::vector<int> starts, ends;
+	std::vector<uint8_t> codes;
+	std::array<std::vector<int>, DNA_SIGMA> runs, before;
+	std::array<int, DNA_SIGMA> total{};
+	std::vector<std::pair<int, int>> phi_pairs;
+	int prev = -1;
+	for (int i=0; i<n; i++) {
+		int c = dnaCode(T[SA[i] > 0 ? SA[i] - 1 : n - 1]);
+		if (c < 0) {
+			throw std::invalid_argument("Unsupported symbol, the DNA index takes A/C/G/T/N and \"$\". ");
+		}
+		if (c != prev) {
+			if (i > 0) {
+				ends.push_back(SA[i - 1]);
+				phi_pairs.push_back({SA[i], SA[i - 1]});
+			}
+			runs[c].push_back(starts.size());
+			before[c].push_back(total[c]);
+			starts.push_back(i);
+			codes.push_back(c);
+			prev = c;
+		}
+		total[c]++;
+	}
+	ends.push_back(SA[n - 1]);
+	SA = std::vector<int>();
+
+	int sum = 0;
+	for (int c : DNA_LEX_ORDER) {
+		C[c] = sum;
+		sum += total[c];
+	}
+	for (int c=0; c<DNA_SIGMA; c++) {
+		before[c].push_back(total[c]);
+		code_runs[c] = std::move(runs[c]);
+		code_before[c] = std::move(before[c]);
+	}
+	std::sort(phi_pairs.begin(), phi_pairs.end());
+	std::vector<int> from(phi_pairs.size()), to(phi_pairs.size());
+	for (size_t k=0; k<phi_pairs.size(); k++) {
+		from[k] = phi_pairs[k].first;
+		to[k] = phi_pairs[k].second;
+	}
+	run_start = std::move(starts);
+	run_code = std::move(codes);
+	end_sa = std::move(ends);
+	phi_from = std::move(from);
+	phi_to = std::move(to);
+}
+
+int RLFMIndex::runOf(int i) const {
+	return std::upper_bound(run_start.begin(), run_start.end(), i) - run_start.begin() - 1;
+}
+
+int RLFMIndex::rank(int c, int i) const {
+	if (i == 0) return 0;
+	int k = runOf(i - 1);
+	// runs of c before run k, then the part of run k up to i
+	const Storage<int>& list = code_runs[c];
+	int m = std::lower_bound(list.begin(), list.end(), k) - list.begin();
+	int r = code_before[c][m];
+	if (run_code[k] == c) r += i - run_start[k];
+	return r;
+}
+
+int RLFMIndex::phi(int pos) const {
+	// pos and the last sampled run start at or before it have their previous
+	// rows in the same run, so both step back by the same distance
+	int k = std::upper_bound(phi_from.begin(), phi_from.end(), pos) - phi_from.begin() - 1;
+	return phi_to[k] + (pos - phi_from[k]);
+}
+
+SAInterval RLFMIndex::search(std::string_view pattern, int& last_sa) const {
+	int sp = 0, ep = n - 1;
+	last_sa = end_sa.back();
+	for (int i=pattern.size()-1; i>=0; i--) {
+		int c = dnaCode(pattern[i]);
+		if (c < 0) return {1, 0};
+		// the new last row comes from the last c in [sp, ep]: row ep itself, or
+		// the end of the last c run before ep's run
+		int k = runOf(ep);
+		if (run_code[k] == c) {
+			last_sa--;
+		} else {
+			const Storage<int>& list = code_runs[c];
+			int m = std::lower_bound(list.begin(), list.end(), k) - list.begin();
+			if (m == 0) return {1, 0};
+			last_sa = end_sa[list[m - 1]] - 1;
+		}
+		// a row of text position 0 has '$' before it, i.e. the pattern holds
+		// '$'; the text is cyclic there, its '$' sits at n - 1
+		if (last_sa < 0) last_sa = n - 1;
+		sp = C[c] + rank(c, sp);
+		ep = C[c] + rank(c, ep + 1) - 1;
+		if (sp > ep) return {1, 0};
+	}
+	return {sp, ep};
+}
+
+SAInterval RLFMIndex::search(std::string_view pattern) const {
+	int last_sa;
+	return search(pattern, last_sa);
+}
+
+std::vector<int> RLFMIndex::query(const std::string& pattern) const {
+	int last_sa;
+	SAInterval range = search(pattern, last_sa);
+	// rows ep, ep-1, ..., sp by repeated phi, returned in row order like FMIndex
+	std::vector<int> result(range.size());
+	int pos = last_sa;
+	for (int k=range.size()-1; k>=0; k--) {
+		result[k] = pos;
+		if (k > 0) pos = phi(pos);
+	}
+	return result;
+}
+
+size_t RLFMIndex::bytes() const {
+	size_t total = run_start.bytes() + run_code.bytes() + end_sa.bytes() + phi_from.bytes() + phi_to.bytes();
+	for (int c=0; c<DNA_SIGMA; c++) total += code_runs[c].bytes() + code_before[c].bytes();
+	return total;
+}
+
+void RLFMIndex::save(const std::string& path) const {
+	IndexWriter out(path);
+	out.writeValue(n);
+	out.write(C.data(), C.size());
+	out.write(run_start);
+	out.write(run_code);
+	for (int c=0; c<DNA_SIGMA; c++) {
+		out.write(code_runs[c]);
+		out.write(code_before[c]);
+	}
+	out.write(end_sa);
+	out.write(phi_from);
+	out.write(phi_to);
+	out.finish();
+}
+
+RLFMIndex RLFMIndex::load(const std::string& path) {
+	IndexReader in(path);
+	RLFMIndex rl;
+	rl.n = in.nextValue<int>();
+	Storage<int> c_table = in.next<int>();
+	if (c_table.size() != rl.C.size()) {
+		throw std::runtime_error("Corrupt index file: C table size. ");
+	}
+	std::copy(c_table.begin(), c_table.end(), rl.C.begin());
+	rl.run_start = in.next<int>();
+	rl.run_code = in.next<uint8_t>();
+	for (int c=0; c<DNA_SIGMA; c++) {
+		rl.code_runs[c] = in.next<int>();
+		rl.code_before[c] = in.next<int>();
+		if (rl.code_before[c].size() != rl.code_runs[c].size() + 1) {
+			throw std::runtime_error("Corrupt index file: run counts. ");
+		}
+	}
+	rl.end_sa = in.next<int>();
+	rl.phi_from = in.next<int>();
+	rl.phi_to = in.next<int>();
+	if (rl.run_code.size() != rl.run_start.size() || rl.end_sa.size() != rl.run_start.size()
+		|| rl.phi_from.size() + 1 != rl.run_start.size() || rl.phi_to.size() != rl.phi_from.size()) {
+		throw std::runtime_error("Corrupt index file: run tables. ");
+	}
+	rl.mapping = in.mapping();
+	return rl;
+}
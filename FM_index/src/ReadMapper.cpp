@@ -0,0 +1,164 @@
+#include "ReadMapper.hpp"
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+void checkOptions(const MapperOptions& opt) {
+	if (opt.seed_length < 1 || opt.max_occ < 1 || opt.band < 0 || opt.max_candidates < 1) {
+		throw std::invalid_argument("Mapper needs seed_length, max_occ and max_candidates >= 1 and band >= 0. ");
+	}
+}
+
+std::string reverseComplement(std::string_view read) {
+	std::string rc(read.rbegin(), read.rend());
+	for (auto& c : rc) {
+		switch (c) {
+			case 'A': c = 'T'; break;
+			case 'C': c = 'G'; break;
+			case 'G': c = 'C'; break;
+			case 'T': c = 'A'; break;
+			default: c = 'N';
+		}
+	}
+	return rc;
+}
+
+}
+
+ReadMapper::ReadMapper(const FMIndex& index, std::string_view text, const ContigTable* contigs, const MapperOptions& opt)
+	: fm(&index), text(text), contigs(contigs), opt(opt) {
+	checkOptions(opt);
+	if (!text.empty() && int(text.size()) != fm->all().size()) {
+		throw std::invalid_argument("Mapper text does not match the index. ");
+	}
+}
+
+ReadMapper::ReadMapper(const BiFMIndex& index, std::string_view text, const ContigTable* contigs, const MapperOptions& opt)
+	: ReadMapper(index.forward(), text, contigs, opt) {
+	bi = &index;
+}
+
+void ReadMapper::collectHits(std::string_view read, std::vector<SeedHit>& hits) const {
+	hits.clear();
+	std::vector<int> positions;
+	auto add = [&](const SAInterval& range, int begin, int end) {
+		if (range.empty() || range.size() > opt.max_occ) return;
+		positions.resize(range.size());
+		fm->locate(range, positions.begin());
+		for (int pos : positions) hits.push_back({pos - begin, begin, end});
+	};
+	const int m = read.size();
+	if (bi) {
+		std::vector<SMEM> smems;
+		bi->smems(read, smems, opt.seed_length);
+		for (auto& s : smems) add(s.range, s.begin, s.end);
+		return;
+	}
+	// tile the read, the last seed flush with its end
+	const int L = std::min(opt.seed_length, m);
+	for (int begin=0; begin<m; begin+=L) {
+		begin = std::min(begin, m - L);
+		add(fm->search(read.substr(begin, L)), begin, begin + L);
+	}
+}
+
+void ReadMapper::chainHits(std::vector<SeedHit>& hits, int read_len, bool reverse, std::vector<Candidate>& out) const {
+	std::sort(hits.begin(), hits.end(), [](const SeedHit& a, const SeedHit& b) { return a.diagonal < b.diagonal; });
+	const int n = fm->all().size() - 1;
+	std::vector<std::pair<int, int>> spans;
+	std::vector<int> ids;
+	// contig of a seed hit, -1 without a table
+	auto contigOf = [&](const SeedHit& h) { return contigs ? contigs->find(h.diagonal + h.begin) : -1; };
+	size_t first_new = out.size();
+	for (size_t i=0; i<hits.size();) {
+		// hits within band of the chain's first diagonal
+		size_t j = i;
+		while (j < hits.size() && hits[j].diagonal - hits[i].diagonal <= opt.band) j++;
+		// a chain can reach over a separator, where an alignment resolves to
+		// no contig; each contig its seeds land on gets a window clipped to it
+		ids.clear();
+		for (size_t k=i; k<j; k++) ids.push_back(contigOf(hits[k]));
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		for (int id : ids) {
+			// read bases the contig's seeds cover, overlaps counted once
+			spans.clear();
+			for (size_t k=i; k<j; k++) {
+				if (contigOf(hits[k]) == id) spans.push_back({hits[k].begin, hits[k].end});
+			}
+			std::sort(spans.begin(), spans.end());
+			int covered = 0, reach = 0;
+			for (auto [b, e] : spans) {
+				covered += std::max(0, e - std::max(b, reach));
+				reach = std::max(reach, e);
+			}
+			Candidate c{covered, reverse, std::max(0, hits[i].diagonal - opt.band),
+				std::min(n, hits[j - 1].diagonal + read_len + opt.band)};
+			if (id >= 0) {
+				c.first = std::max(c.first, contigs->start(id));
+				c.last = std::min(c.last, contigs->start(id) + contigs->length(id));
+			}
+			// overlapping windows are one locus, align it once
+			if (out.size() > first_new && out.back().last >= c.first) {
+				out.back().covered += c.covered;
+				out.back().last = std::max(out.back().last, c.last);
+			} else if (c.first < c.last) {
+				out.push_back(c);
+			}
+		}
+		i = j;
+	}
+}
+
+std::string_view ReadMapper::window(const Candidate& c, std::string& buffer) const {
+	if (!text.empty()) return text.substr(c.first, c.last - c.first);
+	buffer = fm->extract(c.first, c.last - c.first);
+	return buffer;
+}
+
+Mapping ReadMapper::map(std::string_view read) const {
+	Mapping result;
+	if (read.empty()) return result;
+	const int m = read.size();
+	std::string rc = reverseComplement(read);
+
+	std::vector<SeedHit> hits;
+	std::vector<Candidate> candidates;
+	collectHits(read, hits);
+	chainHits(hits, m, false, candidates);
+	collectHits(rc, hits);
+	chainHits(hits, m, true, candidates);
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.covered > b.covered; });
+	if (int(candidates.size()) > opt.max_candidates) candidates.resize(opt.max_candidates);
+
+	// one profile per strand, built the first time a window needs it
+	std::unique_ptr<QueryProfile> profiles[2];
+	std::string buffer;
+	LocalHit best;
+	int best_idx = -1;
+	for (size_t k=0; k<candidates.size(); k++) {
+		const Candidate& c = candidates[k];
+		auto& profile = profiles[c.reverse];
+		if (!profile) profile = std::make_unique<QueryProfile>(c.reverse ? std::string_view(rc) : read, opt.scoring);
+		LocalHit hit = profile->align(window(c, buffer));
+		if (hit.score > best.score) {
+			result.second_score = best.score;
+			best = hit;
+			best_idx = k;
+		} else {
+			result.second_score = std::max(result.second_score, hit.score);
+		}
+	}
+	if (best_idx < 0 || best.score < opt.min_score) return result;
+
+	const Candidate& c = candidates[best_idx];
+	result.mapped = true;
+	result.reverse = c.reverse;
+	result.alignment = tracebackAlign(c.reverse ? std::string_view(rc) : read,
+		window(c, buffer), best, opt.scoring);
+	result.alignment.ref_begin += c.first;
+	result.alignment.ref_end += c.first;
+	return result;
+}
@@ -0,0 +1,204 @@
+#include "SAIS.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+// level 0: bytes of T, the trailing '$' mapped to 0 so it is the sentinel
+struct ByteText {
+	const unsigned char* s;
+	int last;
+	int operator[](int i) const { return i == last ? 0 : s[i] + 1; }
+};
+
+// level >= 1: reduced string of LMS names stored inside SA
+struct IntText {
+	const int* s;
+	int operator[](int i) const { return s[i]; }
+};
+
+// S/L type of every position, one bit each (1 = S-type)
+class TypeBits {
+public:
+	explicit TypeBits(int n) : bits((n >> 3) + 1, 0) { }
+	bool get(int i) const { return (bits[i >> 3] >> (i & 7)) & 1; }
+	void set(int i, bool b) {
+		if (b) bits[i >> 3] |= (1u << (i & 7));
+		else bits[i >> 3] &= ~(1u << (i & 7));
+	}
+	bool isLMS(int i) const { return i > 0 && get(i) && !get(i - 1); }
+
+private:
+	std::vector<uint8_t> bits;
+};
+
+// bucket arrays of one level with K + 1 symbols. cnt holds the symbol
+// counts, or is null when there is no room for it: getBuckets() then counts
+// into bkt on every call, one more pass over the text instead of K ints.
+struct Buckets {
+	int* cnt;
+	int* bkt;
+	int size;
+};
+
+// alphabets this small always get both arrays, allocated if need be
+constexpr int SMALL_ALPHABET = 1 << 16;
+
+// bucket heads (end = false) or one-past-tails (end = true)
+template <typename Text>
+void getBuckets(const Text& s, int n, const Buckets& b, bool end) {
+	if (!b.cnt) {
+		std::fill(b.bkt, b.bkt + b.size, 0);
+		for (int i=0; i<n; i++) b.bkt[s[i]]++;
+	}
+	const int* cnt = b.cnt ? b.cnt : b.bkt;
+	int sum = 0;
+	for (int c=0; c<b.size; c++) {
+		int f = cnt[c];
+		sum += f;
+		b.bkt[c] = end ? sum : sum - f;
+	}
+}
+
+template <typename Text>
+void induceL(const TypeBits& t, int* SA, const Text& s, const Buckets& b, int n) {
+	getBuckets(s, n, b, false);
+	for (int i=0; i<n; i++) {
+		int j = SA[i] - 1;
+		if (j >= 0 && !t.get(j)) SA[b.bkt[s[j]]++] = j;
+	}
+}
+
+template <typename Text>
+void induceS(const TypeBits& t, int* SA, const Text& s, const Buckets& b, int n) {
+	getBuckets(s, n, b, true);
+	for (int i=n-1; i>=0; i--) {
+		int j = SA[i] - 1;
+		if (j >= 0 && t.get(j)) SA[--b.bkt[s[j]]] = j;
+	}
+}
+
+// Bucket arrays in the fs ints at work, memory the caller does not use
+// while this level runs; owned holds them when they do not fit.
+template <typename Text>
+Buckets makeBuckets(const Text& s, int n, int K, int* work, int fs, std::vector<int>& owned) {
+	const int size = K + 1;
+	Buckets b{nullptr, nullptr, size};
+	if (fs >= 2 * size) {
+		b.cnt = work;
+		b.bkt = work + size;
+	} else if (fs >= size) {
+		b.bkt = work;
+	} else if (size <= SMALL_ALPHABET) {
+		owned.resize(2 * size);
+		b.cnt = owned.data();
+		b.bkt = owned.data() + size;
+	} else {
+		owned.resize(size);
+		b.bkt = owned.data();
+	}
+	if (b.cnt) {
+		std::fill(b.cnt, b.cnt + size, 0);
+		for (int i=0; i<n; i++) b.cnt[s[i]]++;
+	}
+	return b;
+}
+
+// s[n-1] must be the unique smallest symbol, all symbols in [0, K]; the fs
+// ints at work are free for the bucket arrays
+template <typename Text>
+void sais(const Text& s, int* SA, int n, int K, int* work, int fs) {
+	if (n == 1) {
+		SA[0] = 0;
+		return;
+	}
+	// classify positions
+	TypeBits t(n);
+	t.set(n-1, true);
+	t.set(n-2, false);
+	for (int i=n-3; i>=0; i--) {
+		t.set(i, s[i] < s[i+1] || (s[i] == s[i+1] && t.get(i+1)));
+	}
+
+	// stage 1: sort LMS substrings
+	std::vector<int> owned;
+	Buckets b = makeBuckets(s, n, K, work, fs, owned);
+	getBuckets(s, n, b, true);
+	std::fill(SA, SA + n, -1);
+	for (int i=1; i<n; i++) {
+		if (t.isLMS(i)) SA[--b.bkt[s[i]]] = i;
+	}
+	induceL(t, SA, s, b, n);
+	induceS(t, SA, s, b, n);
+	std::vector<int>().swap(owned);
+
+	// compact the sorted LMS substrings into the front of SA
+	int n1 = 0;
+	for (int i=0; i<n; i++) {
+		if (t.isLMS(SA[i])) SA[n1++] = SA[i];
+	}
+	// name them, equal substrings share a name
+	std::fill(SA + n1, SA + n, -1);
+	int name = 0, prev = -1;
+	for (int i=0; i<n1; i++) {
+		int pos = SA[i];
+		bool diff = false;
+		for (int d=0; d<n; d++) {
+			if (prev == -1 || s[pos+d] != s[prev+d] || t.get(pos+d) != t.get(prev+d)) {
+				diff = true;
+				break;
+			} else if (d > 0 && (t.isLMS(pos+d) || t.isLMS(prev+d))) {
+				break;
+			}
+		}
+		if (diff) {
+			name++;
+			prev = pos;
+		}
+		SA[n1 + pos / 2] = name - 1;
+	}
+	for (int i=n-1, j=n-1; i>=n1; i--) {
+		if (SA[i] >= 0) SA[j--] = SA[i];
+	}
+
+	// stage 2: sort the reduced problem, recursing only if names collide;
+	// the reduced SA and text sit at the two ends of SA and the gap between
+	// them is the recursion's bucket space
+	int* SA1 = SA;
+	int* s1 = SA + n - n1;
+	if (name < n1) sais(IntText{s1}, SA1, n1, name - 1, SA + n1, n - 2 * n1);
+	else for (int i=0; i<n1; i++) SA1[s1[i]] = i;
+
+	// stage 3: induce the full SA from the sorted LMS suffixes
+	for (int i=1, j=0; i<n; i++) {
+		if (t.isLMS(i)) s1[j++] = i;
+	}
+	for (int i=0; i<n1; i++) SA1[i] = s1[SA1[i]];
+	std::fill(SA + n1, SA + n, -1);
+	b = makeBuckets(s, n, K, work, fs, owned);
+	getBuckets(s, n, b, true);
+	for (int i=n1-1; i>=0; i--) {
+		int j = SA[i];
+		SA[i] = -1;
+		SA[--b.bkt[s[j]]] = j;
+	}
+	induceL(t, SA, s, b, n);
+	induceS(t, SA, s, b, n);
+}
+
+}
+
+void buildSuffixArray(const std::string& T, std::vector<int>& SA) {
+	const int n = T.size();
+	SA.resize(n);
+	if (n == 0) return;
+	ByteText text{reinterpret_cast<const unsigned char*>(T.data()), n - 1};
+	sais(text, SA.data(), n, 256, nullptr, 0);
+}
+
+void buildSuffixArray(const std::vector<int>& T, std::vector<int>& SA, int K) {
+	const int n = T.size();
+	SA.resize(n);
+	if (n == 0) return;
+	sais(IntText{T.data()}, SA.data(), n, K, nullptr, 0);
+}
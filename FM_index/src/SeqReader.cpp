@@ -0,0 +1,130 @@
+#include "SeqReader.hpp"
+#include <stdexcept>
+#include <climits>
+
+SeqReader::SeqReader(const std::string& path) : in(path) {
+	if (!in) {
+		throw std::runtime_error("Cannot open sequence file: " + path);
+	}
+	int first = in.peek();
+	if (first == '@') fastq = true;
+	else if (first != '>' && first != EOF) {
+		throw std::runtime_error("Not a FASTA/FASTQ file: " + path);
+	}
+}
+
+static std::string recordName(const std::string& header) {
+	// drop the marker and everything after the first whitespace
+	size_t end = header.find_first_of(" \t\r", 1);
+	return header.substr(1, end == std::string::npos ? std::string::npos : end - 1);
+}
+
+static void chompCR(std::string& s) {
+	if (!s.empty() && s.back() == '\r') s.pop_back();
+}
+
+bool SeqReader::next(SeqRecord& rec) {
+	if (fastq) {
+		// @name / sequence / + / quality
+		do {
+			if (!std::getline(in, line)) return false;
+		} while (line.empty());
+		rec.name = recordName(line);
+		std::getline(in, rec.seq);
+		chompCR(rec.seq);
+		std::getline(in, line);
+		std::getline(in, line);
+		return true;
+	}
+	if (!has_line) {
+		do {
+			if (!std::getline(in, line)) return false;
+		} while (line.empty());
+	}
+	rec.name = recordName(line);
+	rec.seq.clear();
+	has_line = false;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line[0] == '>') {
+			has_line = true;
+			break;
+		}
+		chompCR(line);
+		rec.seq += line;
+	}
+	return true;
+}
+
+// the index text, contigs with their separators and the final '$', must fit
+// the int positions of the index and the contig table
+static void checkReferenceLength(size_t text_len, const std::string& path) {
+	if (text_len + 1 > size_t(INT_MAX)) {
+		throw std::runtime_error("Reference exceeds the index limit of 2^31 - 1 symbols: " + path);
+	}
+}
+
+void normalizeSequence(std::string& seq) {
+	for (char& c : seq) {
+		switch (c) {
+		case 'A': case 'a': c = 'A'; break;
+		case 'C': case 'c': c = 'C'; break;
+		case 'G': case 'g': c = 'G'; break;
+		case 'T': case 't': c = 'T'; break;
+		default: c = 'N';
+		}
+	}
+}
+
+std::string readReference(const std::string& path, ContigTable& contigs) {
+	SeqReader reader(path);
+	SeqRecord rec;
+	std::vector<std::string> names;
+	std::vector<int> lengths;
+	std::string text;
+	while (reader.next(rec)) {
+		if (!names.empty()) text.push_back(CONTIG_SEPARATOR);
+		normalizeSequence(rec.seq);
+		names.push_back(std::move(rec.name));
+		checkReferenceLength(text.size() + rec.seq.size(), path);
+		lengths.push_back(rec.seq.size());
+		text += rec.seq;
+	}
+	if (names.empty()) {
+		throw std::runtime_error("Reference file is empty: " + path);
+	}
+	text.push_back('$');
+	contigs = ContigTable(names, lengths);
+	return text;
+}
+
+void writeReferenceText(const std::string& path, const std::string& text_path, ContigTable& contigs) {
+	SeqReader reader(path);
+	std::ofstream out(text_path, std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("Cannot write index text: " + text_path);
+	}
+	SeqRecord rec;
+	std::vector<std::string> names;
+	std::vector<int> lengths;
+	size_t text_len = 0;
+	while (reader.next(rec)) {
+		if (!names.empty()) {
+			out.put(CONTIG_SEPARATOR);
+			text_len++;
+		}
+		normalizeSequence(rec.seq);
+		text_len += rec.seq.size();
+		checkReferenceLength(text_len, path);
+		names.push_back(std::move(rec.name));
+		lengths.push_back(rec.seq.size());
+		out.write(rec.seq.data(), rec.seq.size());
+	}
+	if (names.empty()) {
+		throw std::runtime_error("Reference file is empty: " + path);
+	}
+	out.put('$');
+	if (!out) {
+		throw std::runtime_error("Cannot write index text: " + text_path);
+	}
+	contigs = ContigTable(names, lengths);
+}
@@ -0,0 +1,198 @@
+#include "StripedSW.hpp"
+#include "DnaBWT.hpp"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace {
+
+// A/C/G/T codes, anything else scores as N, a mismatch against every symbol
+int alignCode(char ch) {
+	int c = dnaCode(ch);
+	return c >= 0 && c <= DNA_T ? c : DNA_N;
+}
+
+}
+
+QueryProfile::QueryProfile(std::string_view query, const AlignScoring& scoring) : len(query.size()), sc(scoring) {
+	if (sc.match < 1 || sc.mismatch < 0 || sc.gap_extend < 1 || sc.gap_open < sc.gap_extend) {
+		throw std::invalid_argument("Scoring needs match >= 1, mismatch >= 0 and gap_open >= gap_extend >= 1. ");
+	}
+	if (query.size() > size_t(INT16_MAX / (2 * sc.match))) {
+		throw std::invalid_argument("Query too long for 16-bit alignment scores. ");
+	}
+	constexpr int B = Batch::size;
+	segs = std::max(1, (len + B - 1) / B);
+	profile.resize(5 * segs);
+	// padding lanes past the query end can never score
+	const int16_t pad = INT16_MIN / 2;
+	for (int r=0; r<5; r++) {
+		for (int s=0; s<segs; s++) {
+			alignas(Batch::arch_type::alignment()) int16_t lanes[B];
+			for (int k=0; k<B; k++) {
+				int q = k * segs + s;
+				if (q >= len) lanes[k] = pad;
+				else {
+					int c = alignCode(query[q]);
+					lanes[k] = c == r && c != DNA_N ? sc.match : -sc.mismatch;
+				}
+			}
+			profile[r * segs + s] = Batch::load_aligned(lanes);
+		}
+	}
+	h_load.resize(segs);
+	h_store.resize(segs);
+	e.resize(segs);
+}
+
+LocalHit QueryProfile::align(std::string_view ref) const {
+	constexpr int B = Batch::size;
+	const Batch zero(int16_t(0)), gap_open(int16_t(sc.gap_open)), gap_extend(int16_t(sc.gap_extend));
+	// added after a lane shift, so lane 0 starts each pass with no gap to carry
+	alignas(Batch::arch_type::alignment()) int16_t first_lane[B] = {INT16_MIN};
+	const Batch shift_in = Batch::load_aligned(first_lane);
+	// with gap_extend equal to gap_open a gap that just raised H extends as
+	// well as a new one opens, so a tie has to keep the lazy loop going
+	const Batch tie(int16_t(sc.gap_extend == sc.gap_open));
+	std::fill(h_store.begin(), h_store.end(), zero);
+	std::fill(e.begin(), e.end(), zero);
+	LocalHit hit;
+	if (len == 0) return hit;
+
+	for (int i=0; i<int(ref.size()); i++) {
+		const Batch* score = &profile[alignCode(ref[i]) * segs];
+		Batch f = zero, col_max = zero;
+		// H of the previous column one query position up: the last segment's
+		// lanes move one lane over, lane 0 takes the zero boundary
+		Batch h = xsimd::slide_left<2>(h_store[segs - 1]);
+		std::swap(h_load, h_store);
+		for (int s=0; s<segs; s++) {
+			h = xsimd::sadd(h, score[s]);
+			h = xsimd::max(h, e[s]);
+			h = xsimd::max(h, f);
+			h = xsimd::max(h, zero);
+			col_max = xsimd::max(col_max, h);
+			h_store[s] = h;
+			Batch open = xsimd::ssub(h, gap_open);
+			e[s] = xsimd::max(xsimd::ssub(e[s], gap_extend), open);
+			f = xsimd::max(xsimd::ssub(f, gap_extend), open);
+			h = h_load[s];
+		}
+		// lazy F: carry gaps across segment boundaries until they stop
+		// raising any H
+		f = xsimd::sadd(xsimd::slide_left<2>(f), shift_in);
+		for (int s=0;;) {
+			Batch cur = xsimd::max(h_store[s], f);
+			h_store[s] = cur;
+			col_max = xsimd::max(col_max, cur);
+			Batch open = xsimd::ssub(cur, gap_open);
+			e[s] = xsimd::max(e[s], open);
+			f = xsimd::ssub(f, gap_extend);
+			if (!xsimd::any(xsimd::sadd(f, tie) > open)) break;
+			if (++s == segs) {
+				s = 0;
+				f = xsimd::sadd(xsimd::slide_left<2>(f), shift_in);
+			}
+		}
+
+		int best = xsimd::reduce_max(col_max);
+		if (best > hit.score) {
+			hit.score = best;
+			hit.ref_end = i;
+			// first query position holding it
+			hit.query_end = INT_MAX;
+			for (int s=0; s<segs; s++) {
+				alignas(Batch::arch_type::alignment()) int16_t lanes[B];
+				h_store[s].store_aligned(lanes);
+				for (int k=0; k<B; k++) {
+					int q = k * segs + s;
+					if (q < len && lanes[k] == best) hit.query_end = std::min(hit.query_end, q);
+				}
+			}
+		}
+	}
+	return hit;
+}
+
+Alignment tracebackAlign(std::string_view query, std::string_view ref, const LocalHit& hit, const AlignScoring& scoring) {
+	Alignment aln;
+	if (hit.score <= 0) return aln;
+	// gaps totalling G symbols cost at least gap_open + (G - 1) * gap_extend,
+	// which bounds how far the path strays from the end's diagonal and how
+	// far left of its end the alignment can start
+	const int m = hit.query_end + 1;
+	const int band = std::max(0, (scoring.match * m - hit.score - scoring.gap_open) / scoring.gap_extend + 1);
+	const int offset = std::max(0, hit.ref_end + 1 - m - band);
+	const int w = hit.ref_end + 1 - offset;
+	std::string_view r = ref.substr(offset, w);
+
+	// H, E (reference consumed) and F (query consumed) over the band: row i
+	// holds columns j = i + diag - band .. i + diag + band in slots 1 .. width,
+	// with a never-written slot either side so the neighbours outside the band
+	// read as the boundary. (i, j-1) is one slot left, (i-1, j-1) one row up
+	// and (i-1, j) one row up and one slot right.
+	const int diag = w - m;
+	const int stride = 2 * band + 3;
+	const int NEG = INT_MIN / 4;
+	std::vector<int> H((m + 1) * stride, 0), E(H.size(), NEG), F(H.size(), NEG);
+	auto at = [&](int i, int j) { return i * stride + (j - i - diag + band) + 1; };
+	const int up = stride, up_right = stride - 1;
+	auto sub = [&](int i, int j) {
+		int a = alignCode(query[i - 1]), b = alignCode(r[j - 1]);
+		return a == b && a != DNA_N ? scoring.match : -scoring.mismatch;
+	};
+	for (int i=1; i<=m; i++) {
+		int lo = std::max(1, i + diag - band), hi = std::min(w, i + diag + band);
+		for (int j=lo, k=at(i, lo); j<=hi; j++, k++) {
+			E[k] = std::max(H[k - 1] - scoring.gap_open, E[k - 1] - scoring.gap_extend);
+			F[k] = std::max(H[k - up_right] - scoring.gap_open, F[k - up_right] - scoring.gap_extend);
+			H[k] = std::max({0, H[k - up] + sub(i, j), E[k], F[k]});
+		}
+	}
+
+	// walk back from the end, switching matrices as gaps open and close
+	std::string ops;
+	int i = m, j = w;
+	enum { IN_H, IN_E, IN_F } state = IN_H;
+	while (i > 0 && j > 0) {
+		int k = at(i, j);
+		if (state == IN_H) {
+			if (H[k] == 0) break;
+			if (H[k] == H[k - up] + sub(i, j)) {
+				ops.push_back('M');
+				i--;
+				j--;
+			} else if (H[k] == E[k]) state = IN_E;
+			else state = IN_F;
+		} else if (state == IN_E) {
+			ops.push_back('D');
+			if (E[k] != H[k - 1] - scoring.gap_open) state = IN_E;
+			else state = IN_H;
+			j--;
+		} else {
+			ops.push_back('I');
+			if (F[k] != H[k - up_right] - scoring.gap_open) state = IN_F;
+			else state = IN_H;
+			i--;
+		}
+	}
+	std::reverse(ops.begin(), ops.end());
+
+	aln.score = H[at(m, w)];
+	aln.query_begin = i;
+	aln.query_end = m;
+	aln.ref_begin = offset + j;
+	aln.ref_end = hit.ref_end + 1;
+	auto emit = [&](int count, char op) {
+		if (count > 0) aln.cigar += std::to_string(count) + op;
+	};
+	emit(aln.query_begin, 'S');
+	for (size_t p=0; p<ops.size();) {
+		size_t q = p;
+		while (q < ops.size() && ops[q] == ops[p]) q++;
+		emit(q - p, ops[p]);
+		p = q;
+	}
+	emit(int(query.size()) - aln.query_end, 'S');
+	return aln;
+}
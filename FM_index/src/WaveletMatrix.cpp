@@ -0,0 +1,49 @@
+#include "WaveletMatrix.hpp"
+#include <stdexcept>
+#include <bit>
+
+void WaveletMatrix::build(const std::vector<uint8_t>& symbols, int sigma) {
+	n = symbols.size();
+	int bits = std::max(1, int(std::bit_width(unsigned(std::max(sigma - 1, 0)))));
+	levels.assign(bits, BitVector());
+	zeros.assign(bits, 0);
+	std::vector<uint8_t> cur(symbols), next(n);
+	for (int l=0; l<bits; l++) {
+		int shift = bits - 1 - l;
+		BitVector bv(n);
+		int z = 0;
+		for (int i=0; i<n; i++) {
+			if ((cur[i] >> shift) & 1) bv.set(i);
+			else z++;
+		}
+		bv.buildRank();
+		// zeros first then ones, each in their current order
+		int lo = 0, hi = z;
+		for (int i=0; i<n; i++) {
+			if ((cur[i] >> shift) & 1) next[hi++] = cur[i];
+			else next[lo++] = cur[i];
+		}
+		std::swap(cur, next);
+		levels[l] = std::move(bv);
+		zeros[l] = z;
+	}
+}
+
+void WaveletMatrix::save(IndexWriter& out) const {
+	out.writeValue(n);
+	out.write(zeros.data(), zeros.size());
+	for (auto& bv : levels) bv.save(out);
+}
+
+void WaveletMatrix::load(IndexReader& in) {
+	n = in.nextValue<int>();
+	Storage<int> z = in.next<int>();
+	zeros.assign(z.begin(), z.end());
+	levels.assign(zeros.size(), BitVector());
+	for (auto& bv : levels) {
+		bv.load(in);
+		if (bv.size() != size_t(n)) {
+			throw std::runtime_error("Corrupt index file: wavelet level length. ");
+		}
+	}
+}
@@ -0,0 +1,694 @@
+#include "FM_Index.hpp"
+#include "ApproxSearch.hpp"
+#include "BiFMIndex.hpp"
+#include "SAIS.hpp"
+#include "ParallelSA.hpp"
+#include "RLFMIndex.hpp"
+#include "ReadMapper.hpp"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <sys/resource.h>
+using namespace std;
+
+// random ACGT text with a trailing '$', fixed seed so runs are comparable
+string randomGenome(size_t n, unsigned seed) {
+	mt19937 gen(seed);
+	string T(n, 'A');
+	for (auto& c : T) c = "ACGT"[gen() & 3];
+	T.push_back('$');
+	return T;
+}
+
+// substrings of T, so every pattern has at least one hit
+vector<string> samplePatterns(const string& T, size_t count, size_t len, unsigned seed) {
+	mt19937 gen(seed);
+	uniform_int_distribution<size_t> dist(0, T.size() - 1 - len);
+	vector<string> patterns(count);
+	for (auto& p : patterns) p = T.substr(dist(gen), len);
+	return patterns;
+}
+
+// substrings of T with each base substituted at the given rate
+vector<string> simulateReads(const string& T, size_t count, size_t len, double error_rate, unsigned seed) {
+	vector<string> reads = samplePatterns(T, count, len, seed);
+	mt19937 gen(seed + 1);
+	bernoulli_distribution error(error_rate);
+	for (auto& r : reads) {
+		for (auto& c : r) {
+			if (error(gen)) c = "ACGT"[(dnaCode(c) + 1 + gen() % 3) & 3];
+		}
+	}
+	return reads;
+}
+
+// SA memory vs locate latency across sampling rates
+void benchSampling(size_t n, size_t count, size_t len) {
+	string T = randomGenome(n, 1);
+	vector<string> patterns = samplePatterns(T, count, len, 2);
+
+	cout << "------SA sampling (n = " << n << ", " << count << " patterns of " << len << " bp)------\n";
+	cout << setw(6) << "rate" << setw(14) << "SA bytes" << setw(12) << "bytes/bp"
+		 << setw(10) << "saving" << setw(14) << "ns/hit" << "\n";
+	size_t full_bytes = 0;
+	for (int rate : {1, 2, 4, 8, 16, 32, 64, 128}) {
+		FMIndexOptions opt;
+		opt.sa_sample_rate = rate;
+		FMIndex fm(T, opt);
+
+		size_t hits = 0;
+		auto start = chrono::high_resolution_clock::now();
+		for (auto& p : patterns) hits += fm.query(p).size();
+		auto end = chrono::high_resolution_clock::now();
+		double ns = chrono::duration<double, nano>(end - start).count();
+
+		size_t bytes = fm.saBytes();
+		if (rate == 1) full_bytes = bytes;
+		cout << setw(6) << rate << setw(14) << bytes << setw(12) << fixed << setprecision(3) << double(bytes) / n
+			 << setw(9) << setprecision(1) << double(full_bytes) / bytes << "x"
+			 << setw(14) << setprecision(1) << ns / hits << "\n";
+	}
+}
+
+// single-pattern loop vs lockstep batches, reads drawn from the genome
+void benchBatch(size_t n, size_t count, size_t len) {
+	string T = randomGenome(n, 1);
+	vector<string> reads = samplePatterns(T, count, len, 3);
+	FMIndex fm(T);
+
+	cout << "------Batched search (n = " << n << ", " << count << " reads of " << len << " bp)------\n";
+	auto start = chrono::high_resolution_clock::now();
+	size_t hits = 0;
+	for (auto& r : reads) hits += fm.query(r).size();
+	auto end = chrono::high_resolution_clock::now();
+	double t_single = chrono::duration<double>(end - start).count();
+	cout << setw(10) << "single" << setw(16) << fixed << setprecision(0) << count / t_single << " reads/s\n";
+
+	for (int group : {8, 16, 32, 64}) {
+		start = chrono::high_resolution_clock::now();
+		auto result = fm.query_batch(reads, group);
+		end = chrono::high_resolution_clock::now();
+		double t = chrono::duration<double>(end - start).count();
+		size_t batch_hits = 0;
+		for (auto& r : result) batch_hits += r.size();
+		cout << setw(10) << ("batch " + to_string(group)) << setw(16) << setprecision(0) << count / t << " reads/s"
+			 << setw(10) << setprecision(2) << t_single / t << "x"
+			 << (batch_hits == hits ? "" : "  (hit count mismatch)") << "\n";
+	}
+}
+
+// per-query count latency with and without the k-mer start table
+void benchKmer(size_t n, size_t count, size_t len) {
+	string T = randomGenome(n, 1);
+	vector<string> reads = samplePatterns(T, count, len, 4);
+	FMIndex fm(T);
+
+	cout << "------k-mer table (n = " << n << ", " << count << " reads of " << len << " bp)------\n";
+	cout << setw(6) << "k" << setw(14) << "table bytes" << setw(14) << "ns/query" << setw(10) << "speedup" << "\n";
+	double base = 0;
+	for (int k : {0, 8, 10, 12}) {
+		fm.buildKmerTable(k);
+		size_t hits = 0;
+		auto start = chrono::high_resolution_clock::now();
+		for (auto& r : reads) hits += fm.count(r);
+		auto end = chrono::high_resolution_clock::now();
+		double ns = chrono::duration<double, nano>(end - start).count() / count;
+		if (k == 0) base = ns;
+		cout << setw(6) << k << setw(14) << fm.kmerBytes() << setw(14) << fixed << setprecision(1) << ns
+			 << setw(9) << setprecision(2) << base / ns << "x" << (hits < count ? "  (missing hits)" : "") << "\n";
+	}
+}
+
+// reads/s of mismatch and edit search as the allowed differences grow
+void benchApprox(size_t n, size_t count, size_t len) {
+	string T = randomGenome(n, 1);
+	vector<string> reads = simulateReads(T, count, len, 0.01, 5);
+	FMIndex fm(T);
+	FMIndex rev = FMIndex::buildReverse(T);
+	ApproxSearcher searcher(fm, rev);
+
+	cout << "------Approximate search (n = " << n << ", " << count << " reads of " << len << " bp, 1% substitutions)------\n";
+	cout << setw(10) << "model" << setw(4) << "z" << setw(14) << "reads/s" << setw(10) << "mapped" << setw(12) << "over budget" << "\n";
+	vector<ApproxHit> hits;
+	for (ErrorModel model : {ErrorModel::Mismatch, ErrorModel::Edit}) {
+		for (int z=0; z<=2; z++) {
+			ApproxOptions opt;
+			opt.max_diffs = z;
+			opt.model = model;
+			size_t mapped = 0, over = 0;
+			auto start = chrono::high_resolution_clock::now();
+			for (auto& r : reads) {
+				if (!searcher.search(r, opt, hits)) over++;
+				if (!hits.empty()) mapped++;
+			}
+			auto end = chrono::high_resolution_clock::now();
+			double t = chrono::duration<double>(end - start).count();
+			cout << setw(10) << (model == ErrorModel::Mismatch ? "mismatch" : "edit") << setw(4) << z
+				 << setw(14) << fixed << setprecision(0) << count / t
+				 << setw(9) << setprecision(1) << 100.0 * mapped / count << "%"
+				 << setw(11) << 100.0 * over / count << "%\n";
+		}
+	}
+}
+
+// SMEM seeding rate and seed statistics at a few read error rates
+void benchSmem(size_t n, size_t count, size_t len) {
+	string T = randomGenome(n, 1);
+	BiFMIndex bi(T);
+
+	cout << "------SMEM seeding (n = " << n << ", " << count << " reads of " << len << " bp)------\n";
+	cout << setw(8) << "errors" << setw(14) << "reads/s" << setw(14) << "SMEMs/read" << setw(14) << "mean length" << "\n";
+	vector<SMEM> seeds;
+	for (double rate : {0.0, 0.01, 0.05}) {
+		vector<string> reads = simulateReads(T, count, len, rate, 6);
+		size_t total = 0, bases = 0;
+		auto start = chrono::high_resolution_clock::now();
+		for (auto& r : reads) {
+			bi.smems(r, seeds);
+			total += seeds.size();
+			for (auto& s : seeds) bases += s.length();
+		}
+		auto end = chrono::high_resolution_clock::now();
+		double t = chrono::duration<double>(end - start).count();
+		cout << setw(7) << fixed << setprecision(0) << rate * 100 << "%" << setw(14) << count / t
+			 << setw(14) << setprecision(2) << double(total) / count
+			 << setw(14) << setprecision(1) << (total ? double(bases) / total : 0.0) << "\n";
+	}
+}
+
+// index build time from 1 to max_threads threads, doubling; 1 thread is the
+// SA-IS path, the doubling sort is timed alone at 1 thread for reference
+void benchBuild(size_t n, int max_threads) {
+	string T = randomGenome(n, 1);
+	cout << "------Parallel build (n = " << n << ", " << thread::hardware_concurrency() << " cores)------\n";
+
+	vector<int> SA;
+	auto start = chrono::high_resolution_clock::now();
+	buildSuffixArray(T, SA);
+	double t_sais = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	start = chrono::high_resolution_clock::now();
+	buildSuffixArrayParallel(T, SA, 1);
+	double t_doubling = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	SA = vector<int>();
+	cout << "SA only: SA-IS " << fixed << setprecision(2) << t_sais << " s, prefix doubling (1 thread) " << t_doubling << " s\n";
+
+	cout << setw(8) << "threads" << setw(12) << "build s" << setw(10) << "speedup" << "\n";
+	double base = 0;
+	for (int t=1; t<=max_threads; t*=2) {
+		FMIndexOptions opt;
+		opt.threads = t;
+		start = chrono::high_resolution_clock::now();
+		FMIndex fm(T, opt);
+		double sec = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+		if (t == 1) base = sec;
+		cout << setw(8) << t << setw(12) << setprecision(2) << sec << setw(9) << base / sec << "x\n";
+	}
+}
+
+// copies of one random base genome, each with its own substitutions at the
+// given rate, like many strains of one organism
+string repetitiveGenome(size_t base_len, int copies, double mutation_rate, unsigned seed) {
+	string base = randomGenome(base_len, seed);
+	base.pop_back();
+	mt19937 gen(seed + 1);
+	bernoulli_distribution mutate(mutation_rate);
+	string T;
+	T.reserve(base_len * copies + 1);
+	for (int k=0; k<copies; k++) {
+		for (char c : base) T.push_back(mutate(gen) ? "ACGT"[gen() & 3] : c);
+	}
+	T.push_back('$');
+	return T;
+}
+
+// plain vs run-length index on a repetitive collection: size and latency
+void benchRunLength(size_t base_len, int copies, double mutation_rate) {
+	string T = repetitiveGenome(base_len, copies, mutation_rate, 1);
+	vector<string> patterns = samplePatterns(T, 100000, 20, 7);
+	FMIndex fm(T);
+	RLFMIndex rl(T);
+	size_t n = T.size();
+
+	cout << "------Run-length index (" << copies << " copies of " << base_len << " bp, "
+		 << mutation_rate * 100 << "% substitutions, n = " << n << ", r = " << rl.runs() << ")------\n";
+	cout << setw(8) << "index" << setw(14) << "bytes" << setw(12) << "bits/bp"
+		 << setw(14) << "count ns" << setw(14) << "locate ns/hit" << "\n";
+	auto report = [&](const string& name, size_t bytes, auto& index) {
+		size_t total = 0;
+		auto start = chrono::high_resolution_clock::now();
+		for (auto& p : patterns) total += index.count(p);
+		double t_count = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count();
+		size_t hits = 0;
+		start = chrono::high_resolution_clock::now();
+		for (auto& p : patterns) hits += index.query(p).size();
+		double t_locate = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count();
+		cout << setw(8) << name << setw(14) << bytes << setw(12) << fixed << setprecision(3) << 8.0 * bytes / n
+			 << setw(14) << setprecision(1) << t_count / patterns.size() << setw(14) << t_locate / hits
+			 << (total == hits ? "" : "  (hit count mismatch)") << "\n";
+	};
+	report("plain", fm.bwtBytes() + fm.saBytes(), fm);
+	report("rlbwt", rl.bytes(), rl);
+}
+
+// peak resident set of the process so far, in MB
+double peakRssMB() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.0;
+}
+
+// on-disk build under a memory budget against the in-memory build; the
+// external build runs first since peak RSS only ever grows
+void benchExternal(size_t n, size_t budget_mb) {
+	// the same text as randomGenome(n, 1), written in pieces so it never
+	// counts towards the peak
+	string path = "/tmp/fm_bench_text.txt";
+	{
+		ofstream out(path, ios::binary);
+		mt19937 gen(1);
+		string piece;
+		for (size_t done=0; done<n; done+=piece.size()) {
+			piece.resize(min<size_t>(n - done, 1 << 20));
+			for (auto& c : piece) c = "ACGT"[gen() & 3];
+			out << piece;
+		}
+		out << '$';
+	}
+	cout << "------External build (n = " << n << ", budget " << budget_mb << " MB)------\n";
+	cout << setw(10) << "mode" << setw(12) << "build s" << setw(14) << "peak RSS MB" << "\n";
+	double base = peakRssMB();
+	auto start = chrono::high_resolution_clock::now();
+	FMIndex ext = FMIndex::buildExternal(path, budget_mb << 20, "/tmp");
+	double t_ext = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	double rss_ext = peakRssMB();
+	cout << setw(10) << "external" << setw(12) << fixed << setprecision(2) << t_ext << setw(14) << setprecision(0) << rss_ext - base << "\n";
+
+	string T = randomGenome(n, 1);
+	start = chrono::high_resolution_clock::now();
+	FMIndex mem(T);
+	double t_mem = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	cout << setw(10) << "memory" << setw(12) << setprecision(2) << t_mem << setw(14) << setprecision(0) << peakRssMB() - base << "\n";
+	remove(path.c_str());
+}
+
+// merging added contigs into an index against rebuilding it from the joined
+// text, for growing amounts of new sequence
+void benchAppend(size_t n, size_t max_added) {
+	string T = randomGenome(n, 1);
+	cout << "------Append to index (n = " << n << ")------\n";
+	cout << setw(12) << "added" << setw(12) << "add s" << setw(12) << "rebuild s" << setw(10) << "speedup" << "\n";
+	for (size_t added=max_added/64; added<=max_added; added*=4) {
+		FMIndex fm(T);
+		string S = randomGenome(added, 2);
+		S.back() = 'N';
+		auto start = chrono::high_resolution_clock::now();
+		fm.add(S);
+		double t_add = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		start = chrono::high_resolution_clock::now();
+		FMIndex full(S + T);
+		double t_full = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+		for (const string& p : samplePatterns(S + T, 1000, 20, 3)) {
+			if (fm.count(p) != full.count(p)) {
+				cerr << "Merged and rebuilt indexes disagree on " << p << endl;
+				return;
+			}
+		}
+		cout << setw(12) << added << setw(12) << fixed << setprecision(3) << t_add << setw(12) << t_full
+			 << setw(9) << setprecision(1) << t_full / t_add << "x\n";
+	}
+}
+
+// substrings recovered from the index by extract() at each SA sample rate,
+// and the full inversion against the thread count
+void benchExtract(size_t n, size_t count, int max_threads) {
+	string T = randomGenome(n, 1);
+	cout << "------Extract (n = " << n << ", " << count << " substrings)------\n";
+	cout << setw(8) << "rate" << setw(8) << "len" << setw(14) << "ns/substr" << setw(12) << "ns/base" << setw(12) << "SA+ISA MB" << "\n";
+	for (int rate : {8, 32, 128}) {
+		FMIndexOptions opt;
+		opt.sa_sample_rate = rate;
+		FMIndex fm(T, opt);
+		for (int len : {16, 150, 1000}) {
+			mt19937 gen(2);
+			vector<int> starts(count);
+			for (auto& p : starts) p = gen() % (n - len);
+			auto start = chrono::high_resolution_clock::now();
+			for (int p : starts) {
+				volatile char c = fm.extract(p, len)[len / 2];
+				(void)c;
+			}
+			double ns = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count() / count;
+			if (fm.extract(starts[0], len) != T.substr(starts[0], len)) {
+				cerr << "Extracted text differs at " << starts[0] << endl;
+				return;
+			}
+			cout << setw(8) << rate << setw(8) << len << setw(14) << fixed << setprecision(0) << ns
+				 << setw(12) << setprecision(1) << ns / len << setw(12) << fm.saBytes() / 1e6 << "\n";
+		}
+	}
+	FMIndex fm(T);
+	cout << setw(8) << "threads" << setw(12) << "invert s" << "\n";
+	for (int t=1; t<=max_threads; t*=2) {
+		auto start = chrono::high_resolution_clock::now();
+		string back = fm.invert(t);
+		double sec = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+		cout << setw(8) << t << setw(12) << setprecision(3) << sec << (back == T ? "" : "  MISMATCH") << "\n";
+	}
+}
+
+// random protein text over the 20 amino acids, with a trailing '$'
+string randomProtein(size_t n, unsigned seed) {
+	mt19937 gen(seed);
+	const char* amino = "ACDEFGHIKLMNPQRSTVWY";
+	string T(n, 'A');
+	for (auto& c : T) c = amino[gen() % 20];
+	T.push_back('$');
+	return T;
+}
+
+// wavelet rank backend: protein indexes, and the cost over the DNA backend
+void benchWavelet(size_t n, size_t count, size_t len) {
+	cout << "------Rank backends (n = " << n << ", " << count << " patterns of " << len << ")------\n";
+	cout << setw(10) << "text" << setw(10) << "backend" << setw(12) << "build s"
+		 << setw(14) << "bwt bytes" << setw(12) << "bits/sym" << setw(14) << "count ns" << "\n";
+	auto report = [&](const string& text, const string& name, const string& T, RankBackend backend) {
+		FMIndexOptions opt;
+		opt.backend = backend;
+		auto start = chrono::high_resolution_clock::now();
+		FMIndex fm(T, opt);
+		double t_build = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+		vector<string> patterns = samplePatterns(T, count, len, 7);
+		size_t total = 0;
+		start = chrono::high_resolution_clock::now();
+		for (auto& p : patterns) total += fm.count(p);
+		double t_count = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count();
+		cout << setw(10) << text << setw(10) << name << setw(12) << fixed << setprecision(2) << t_build
+			 << setw(14) << fm.bwtBytes() << setw(12) << setprecision(3) << 8.0 * fm.bwtBytes() / T.size()
+			 << setw(14) << setprecision(1) << t_count / count << (total >= count ? "" : "  (missing hits)") << "\n";
+	};
+	string T = randomGenome(n, 1);
+	report("dna", "dna", T, RankBackend::Dna);
+	report("dna", "wavelet", T, RankBackend::Wavelet);
+	T = randomProtein(n, 1);
+	report("protein", "wavelet", T, RankBackend::Wavelet);
+}
+
+// random genome with a fraction of it made of interspersed repeats: copies
+// of a few random elements (300 bp to 6 kbp), each copy with 2% substitutions
+string syntheticGenome(size_t n, double repeat_fraction, unsigned seed) {
+	string T = randomGenome(n, seed);
+	T.pop_back();
+	mt19937 gen(seed + 1);
+	vector<string> family(8);
+	for (auto& e : family) {
+		e.resize(300 + gen() % 5700);
+		for (auto& c : e) c = "ACGT"[gen() & 3];
+	}
+	bernoulli_distribution mutate(0.02);
+	size_t target = n * repeat_fraction, placed = 0;
+	while (placed < target) {
+		const string& e = family[gen() % family.size()];
+		size_t len = min({e.size(), target - placed, n});
+		size_t pos = gen() % (n - len + 1);
+		for (size_t i=0; i<len; i++) T[pos + i] = mutate(gen) ? "ACGT"[gen() & 3] : e[i];
+		placed += len;
+	}
+	T.push_back('$');
+	return T;
+}
+
+// nearest-rank percentiles of per-read latencies in ns, as a JSON object
+string latencyJson(vector<double>& ns) {
+	sort(ns.begin(), ns.end());
+	auto at = [&](double q) { return ns[min(ns.size() - 1, size_t(q * ns.size()))]; };
+	double sum = 0;
+	for (double t : ns) sum += t;
+	ostringstream out;
+	out << fixed << setprecision(1) << "{\"mean\": " << sum / ns.size() << ", \"p50\": " << at(0.5)
+		<< ", \"p90\": " << at(0.9) << ", \"p99\": " << at(0.99) << ", \"max\": " << ns.back() << "}";
+	return out.str();
+}
+
+// the whole pipeline on one synthetic reference, reported as JSON on stdout
+// so runs can be diffed across versions
+void benchSuite(size_t n, double repeat_fraction, size_t count, size_t len, double error_rate,
+	unsigned seed, int sa_rate, int kmer_length) {
+	string T = syntheticGenome(n, repeat_fraction, seed);
+	vector<string> reads = simulateReads(T, count, len, error_rate, seed + 2);
+
+	FMIndexOptions opt;
+	opt.sa_sample_rate = sa_rate;
+	opt.kmer_length = kmer_length;
+	double base_rss = peakRssMB();
+	auto start = chrono::steady_clock::now();
+	FMIndex fm(T, opt);
+	double t_build = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	double build_rss = peakRssMB() - base_rss;
+
+	string path = "/tmp/fm_bench_suite.idx";
+	fm.save(path);
+	ifstream saved(path, ios::binary | ios::ate);
+	size_t file_bytes = saved.tellg();
+	remove(path.c_str());
+
+	// each read timed on its own for the percentiles, then the whole set
+	// untimed per read for throughput
+	auto run = [&](auto&& op, vector<double>& ns) {
+		ns.resize(reads.size());
+		size_t total = 0;
+		for (size_t i=0; i<reads.size(); i++) {
+			auto t0 = chrono::steady_clock::now();
+			total += op(reads[i]);
+			ns[i] = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+		}
+		auto t0 = chrono::steady_clock::now();
+		for (auto& r : reads) total -= op(r);
+		double sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		if (total != 0) throw runtime_error("Benchmark runs disagree. ");
+		return reads.size() / sec;
+	};
+	size_t matched = 0, hits = 0;
+	for (auto& r : reads) {
+		int c = fm.count(r);
+		matched += c > 0;
+		hits += c;
+	}
+	vector<double> count_ns, locate_ns;
+	double count_rate = run([&](const string& r) { return size_t(fm.count(r)); }, count_ns);
+	double locate_rate = run([&](const string& r) { return fm.query(r).size(); }, locate_ns);
+
+	cout << fixed << "{\n"
+		 << "  \"index_format\": " << INDEX_FILE_VERSION << ",\n"
+		 << "  \"config\": {\"text_len\": " << n << ", \"repeat_fraction\": " << setprecision(3) << repeat_fraction
+		 << ", \"reads\": " << count << ", \"read_len\": " << len << ", \"error_rate\": " << setprecision(4) << error_rate
+		 << ", \"seed\": " << seed << ", \"sa_sample_rate\": " << sa_rate << ", \"kmer_length\": " << kmer_length << "},\n"
+		 << "  \"build\": {\"seconds\": " << setprecision(3) << t_build << ", \"peak_rss_mb\": " << setprecision(1) << build_rss << "},\n"
+		 << "  \"index_bytes\": {\"bwt\": " << fm.bwtBytes() << ", \"sa\": " << fm.saBytes() << ", \"kmer\": " << fm.kmerBytes()
+		 << ", \"file\": " << file_bytes << "},\n"
+		 << "  \"reads_matched\": " << matched << ",\n"
+		 << "  \"hits\": " << hits << ",\n"
+		 << "  \"count\": {\"reads_per_s\": " << setprecision(0) << count_rate << ", \"latency_ns\": " << latencyJson(count_ns) << "},\n"
+		 << "  \"locate\": {\"reads_per_s\": " << setprecision(0) << locate_rate << ", \"latency_ns\": " << latencyJson(locate_ns) << "}\n"
+		 << "}" << endl;
+}
+
+// seed-and-extend mapping of reads from both strands with substitutions:
+// exact vs SMEM seeds, reads/s and how many land where they came from
+void benchMap(size_t n, size_t count, size_t len, double error_rate) {
+	string T = randomGenome(n, 1);
+	BiFMIndex bi(T);
+	mt19937 gen(9);
+	uniform_int_distribution<size_t> dist(0, n - len);
+	bernoulli_distribution error(error_rate);
+	vector<string> reads(count);
+	vector<int> origin(count);
+	for (size_t r=0; r<count; r++) {
+		origin[r] = dist(gen);
+		string read = T.substr(origin[r], len);
+		for (auto& c : read) {
+			if (error(gen)) c = "ACGT"[(dnaCode(c) + 1 + gen() % 3) & 3];
+		}
+		if (gen() & 1) {
+			reverse(read.begin(), read.end());
+			for (auto& c : read) c = "TGCA"[dnaCode(c)];
+		}
+		reads[r] = read;
+	}
+
+	cout << "------Mapping (n = " << n << ", " << count << " reads of " << len << " bp, "
+		 << error_rate * 100 << "% substitutions, both strands)------\n";
+	cout << setw(8) << "seeds" << setw(14) << "reads/s" << setw(12) << "mapped" << setw(12) << "correct" << "\n";
+	auto report = [&](const string& name, const ReadMapper& mapper) {
+		size_t mapped = 0, correct = 0;
+		auto start = chrono::high_resolution_clock::now();
+		for (size_t r=0; r<count; r++) {
+			Mapping m = mapper.map(reads[r]);
+			mapped += m.mapped;
+			correct += m.mapped && abs(m.alignment.ref_begin - m.alignment.query_begin - origin[r]) <= 8;
+		}
+		double sec = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+		cout << setw(8) << name << setw(14) << fixed << setprecision(0) << count / sec
+			 << setw(11) << setprecision(1) << 100.0 * mapped / count << "%"
+			 << setw(11) << 100.0 * correct / count << "%\n";
+	};
+	report("exact", ReadMapper(bi.forward(), T));
+	report("smem", ReadMapper(bi, T));
+}
+
+// kB of this process's anonymous memory on transparent hugepages
+size_t anonHugePagesKB() {
+	ifstream in("/proc/self/smaps_rollup");
+	string key;
+	size_t kb = 0;
+	while (in >> key) {
+		if (key == "AnonHugePages:") {
+			in >> kb;
+			break;
+		}
+		in.ignore(numeric_limits<streamsize>::max(), '\n');
+	}
+	return kb;
+}
+
+// per-query latency with the index on normal pages vs hugepages
+void benchHugePages(size_t n, size_t count, size_t len) {
+	string T = randomGenome(n, 1);
+	vector<string> patterns = samplePatterns(T, count, len, 4);
+	cout << "------Hugepages (n = " << n << ", " << count << " patterns of " << len << " bp)------\n";
+	cout << setw(12) << "mode" << setw(12) << "huge MB" << setw(12) << "count p50" << setw(12) << "count p99"
+		 << setw(12) << "count mean" << setw(14) << "locate ns/hit" << "\n";
+	vector<double> ns(count);
+	for (auto [name, mode] : {pair{"off", HugePageMode::ForceOff}, pair{"system", HugePageMode::System}, pair{"thp", HugePageMode::Transparent},
+		pair{"hugetlb", HugePageMode::Explicit}}) {
+		setHugePageMode(mode);
+		FMIndex fm(T);
+		HugePageStats stats = hugePageStats();
+		// hugetlb pages, or the THP the kernel actually granted
+		double huge_mb = stats.hugetlb / 1048576.0 + anonHugePagesKB() / 1024.0;
+		double sum = 0;
+		for (size_t i=0; i<count; i++) {
+			auto t0 = chrono::steady_clock::now();
+			volatile int c = fm.count(patterns[i]);
+			(void)c;
+			ns[i] = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+			sum += ns[i];
+		}
+		sort(ns.begin(), ns.end());
+		size_t hits = 0;
+		auto start = chrono::steady_clock::now();
+		for (auto& p : patterns) hits += fm.query(p).size();
+		double t_locate = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+		cout << setw(12) << name << setw(12) << fixed << setprecision(1) << huge_mb
+			 << setw(12) << setprecision(0) << ns[count / 2] << setw(12) << ns[min(count - 1, count * 99 / 100)]
+			 << setw(12) << sum / count << setw(14) << setprecision(1) << t_locate / hits << "\n";
+	}
+	setHugePageMode(HugePageMode::System);
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " sampling [text_len] [patterns] [pattern_len]\n"
+			 << "       " << argv[0] << " batch [text_len] [reads] [read_len]\n"
+			 << "       " << argv[0] << " kmer [text_len] [reads] [read_len]\n"
+			 << "       " << argv[0] << " approx [text_len] [reads] [read_len]\n"
+			 << "       " << argv[0] << " smem [text_len] [reads] [read_len]\n"
+			 << "       " << argv[0] << " build [text_len] [max_threads]\n"
+			 << "       " << argv[0] << " external [text_len] [budget_mb]\n"
+			 << "       " << argv[0] << " append [text_len] [max_added_len]\n"
+			 << "       " << argv[0] << " extract [text_len] [substrings] [max_threads]\n"
+			 << "       " << argv[0] << " rlbwt [base_len] [copies] [mutation_rate]\n"
+			 << "       " << argv[0] << " wavelet [text_len] [patterns] [pattern_len]\n"
+			 << "       " << argv[0] << " hugepages [text_len] [patterns] [pattern_len]\n"
+			 << "       " << argv[0] << " map [text_len] [reads] [read_len] [error_rate]\n"
+			 << "       " << argv[0] << " suite [text_len] [repeat_fraction] [reads] [read_len] [error_rate] [seed] [sa_rate] [kmer_len]" << endl;
+		return 1;
+	}
+	string mode = argv[1];
+	if (mode == "sampling") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 1000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 100000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 12;
+		benchSampling(n, count, len);
+	} else if (mode == "batch") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 50000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 1000000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 100;
+		benchBatch(n, count, len);
+	} else if (mode == "kmer") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 50000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 1000000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 20;
+		benchKmer(n, count, len);
+	} else if (mode == "approx") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 10000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 20000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 100;
+		benchApprox(n, count, len);
+	} else if (mode == "smem") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 10000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 100000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 100;
+		benchSmem(n, count, len);
+	} else if (mode == "build") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 500000000;
+		int max_threads = argc > 3 ? stoi(argv[3]) : 64;
+		benchBuild(n, max_threads);
+	} else if (mode == "external") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 100000000;
+		size_t budget = argc > 3 ? stoul(argv[3]) : 128;
+		benchExternal(n, budget);
+	} else if (mode == "append") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 50000000;
+		size_t added = argc > 3 ? stoul(argv[3]) : 5000000;
+		benchAppend(n, added);
+	} else if (mode == "extract") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 10000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 10000;
+		int max_threads = argc > 4 ? stoi(argv[4]) : 8;
+		benchExtract(n, count, max_threads);
+	} else if (mode == "rlbwt") {
+		size_t base_len = argc > 2 ? stoul(argv[2]) : 1000000;
+		int copies = argc > 3 ? stoi(argv[3]) : 100;
+		double rate = argc > 4 ? stod(argv[4]) : 0.001;
+		benchRunLength(base_len, copies, rate);
+	} else if (mode == "wavelet") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 20000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 1000000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 12;
+		benchWavelet(n, count, len);
+	} else if (mode == "hugepages") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 1000000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 200000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 100;
+		benchHugePages(n, count, len);
+	} else if (mode == "map") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 10000000;
+		size_t count = argc > 3 ? stoul(argv[3]) : 100000;
+		size_t len = argc > 4 ? stoul(argv[4]) : 150;
+		double error_rate = argc > 5 ? stod(argv[5]) : 0.02;
+		benchMap(n, count, len, error_rate);
+	} else if (mode == "suite") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 10000000;
+		double repeats = argc > 3 ? stod(argv[3]) : 0.3;
+		size_t count = argc > 4 ? stoul(argv[4]) : 200000;
+		size_t len = argc > 5 ? stoul(argv[5]) : 100;
+		double error_rate = argc > 6 ? stod(argv[6]) : 0.01;
+		unsigned seed = argc > 7 ? stoul(argv[7]) : 1;
+		int sa_rate = argc > 8 ? stoi(argv[8]) : 32;
+		int kmer_len = argc > 9 ? stoi(argv[9]) : 0;
+		benchSuite(n, repeats, count, len, error_rate, seed, sa_rate, kmer_len);
+	} else {
+		cerr << "Unknown mode: " << mode << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,10 +1,44 @@
 #include "FM_Index.hpp"
+#include "SeqReader.hpp"
+#include "ReadMapper.hpp"
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <unistd.h>
 using namespace std;
 
-int main() {
+// reads handed to the workers at a time
+const size_t CHUNK_READS = 1 << 16;
+
+struct DriverOptions {
+	string reference;	// FASTA to build from
+	string index;		// or a saved index to load
+	string reads;
+	string output;		// stdout when empty
+	string save;		// write the built index here
+	string update;		// FASTA of contigs to add to the index
+	int threads = max(1u, thread::hardware_concurrency());
+	size_t memory_mb = 0;	// build on disk within this budget, 0 = in memory
+	bool count_only = false;
+	bool scaling = false;
+	bool align = false;	// seed-and-extend alignment instead of exact lookup
+	bool hugepages = false;	// index arrays on 2 MB pages
+};
+
+struct ReadChunk {
+	vector<string> names;
+	vector<string> seqs;
+};
+
+void runDemo() {
     string T = "ACATNCCGTCATGGATTACGTACAG$"; // 注意結尾要加 $
-    FMIndex fm(T);
+    FMIndexOptions opt;
+    opt.verbose = true;
+    FMIndex fm(T, opt);
 
     string pattern = "TTA";
 
@@ -17,8 +51,290 @@ int main() {
 		cout << "\nMatched substrings: \n";
 		for (int pos : result) {
 			int n = T.size();
-			cout << (T.substr(pos-1, n)) <<endl;
+			cout << fm.extract(pos, n - pos) << endl;
+		}
+	}
+}
+
+// "name <tab> count [<tab> contig:offset,...]" for reads [first, last), into
+// out; hits running across a contig separator are dropped
+void lookupSlice(const FMIndex& fm, const ContigTable& contigs, const ReadChunk& chunk, size_t first, size_t last, bool count_only, string& out) {
+	out.clear();
+	span<const string> seqs(chunk.seqs.data() + first, last - first);
+	vector<SAInterval> ranges(seqs.size());
+	fm.search_batch(seqs, ranges);
+
+	vector<int> positions;
+	string hits;
+	for (size_t r=0; r<seqs.size(); r++) {
+		const string& read = seqs[r];
+		int count = ranges[r].size();
+		// only a read containing the separator symbol can match across contigs
+		bool check = count > 0 && read.find(CONTIG_SEPARATOR) != string::npos;
+		hits.clear();
+		if (!count_only || check) {
+			// reused across reads, only grows
+			positions.resize(count);
+			fm.locate(ranges[r], positions.begin());
+			sort(positions.begin(), positions.end());
+			count = 0;
+			for (int pos : positions) {
+				int contig, offset;
+				if (!contigs.resolve(pos, read.size(), contig, offset)) continue;
+				if (count++) hits += ',';
+				hits += contigs.name(contig);
+				hits += ':';
+				hits += to_string(offset);
+			}
+		}
+		out += chunk.names[first + r];
+		out += '\t';
+		out += to_string(count);
+		if (!count_only && count > 0) {
+			out += '\t';
+			out += hits;
+		}
+		out += '\n';
+	}
+}
+
+// "name <tab> contig:offset <tab> +|- <tab> score <tab> cigar", or
+// "name <tab> *" for reads without an alignment inside one contig
+void alignSlice(const ReadMapper& mapper, const ContigTable& contigs, const ReadChunk& chunk, size_t first, size_t last, string& out) {
+	out.clear();
+	for (size_t r=first; r<last; r++) {
+		Mapping m = mapper.map(chunk.seqs[r]);
+		const Alignment& aln = m.alignment;
+		int contig, offset;
+		out += chunk.names[r];
+		if (m.mapped && contigs.resolve(aln.ref_begin, aln.ref_end - aln.ref_begin, contig, offset)) {
+			out += '\t';
+			out += contigs.name(contig);
+			out += ':';
+			out += to_string(offset);
+			out += m.reverse ? "\t-\t" : "\t+\t";
+			out += to_string(aln.score);
+			out += '\t';
+			out += aln.cigar;
+		} else {
+			out += "\t*";
+		}
+		out += '\n';
+	}
+}
+
+// output for reads [first, last) of a chunk
+using SliceFn = function<void(const ReadChunk&, size_t, size_t, string&)>;
+
+// split the chunk into one contiguous slice per thread, each thread writes
+// its own buffer so output order is the slice order
+void processChunk(const SliceFn& slice, const ReadChunk& chunk, int threads, vector<string>& buffers) {
+	size_t total = chunk.seqs.size();
+	size_t per_thread = (total + threads - 1) / threads;
+	vector<thread> workers;
+	for (int t=0; t<threads; t++) {
+		size_t first = min(total, t * per_thread);
+		size_t last = min(total, first + per_thread);
+		workers.emplace_back(slice, cref(chunk), first, last, ref(buffers[t]));
+	}
+	for (auto& w : workers) {
+		w.join();
+	}
+}
+
+bool readChunk(SeqReader& reader, ReadChunk& chunk, size_t limit) {
+	chunk.names.clear();
+	chunk.seqs.clear();
+	SeqRecord rec;
+	while (chunk.seqs.size() < limit && reader.next(rec)) {
+		normalizeSequence(rec.seq);
+		chunk.names.push_back(move(rec.name));
+		chunk.seqs.push_back(move(rec.seq));
+	}
+	return !chunk.seqs.empty();
+}
+
+void runLookup(const SliceFn& slice, const DriverOptions& opt) {
+	ofstream file;
+	if (!opt.output.empty()) {
+		file.open(opt.output);
+		if (!file) throw runtime_error("Cannot open output file: " + opt.output);
+	}
+	ostream& out = opt.output.empty() ? cout : file;
+
+	SeqReader reader(opt.reads);
+	ReadChunk chunk;
+	vector<string> buffers(opt.threads);
+	size_t total = 0;
+	auto start = chrono::high_resolution_clock::now();
+	while (readChunk(reader, chunk, CHUNK_READS)) {
+		processChunk(slice, chunk, opt.threads, buffers);
+		for (auto& b : buffers) out << b;
+		total += chunk.seqs.size();
+	}
+	auto end = chrono::high_resolution_clock::now();
+	double t = chrono::duration<double>(end - start).count();
+	cerr << total << " reads, " << opt.threads << " threads, " << fixed << setprecision(0) << total / t << " reads/s\n";
+}
+
+// all reads are loaded up front so the numbers leave out file I/O
+void runScaling(const SliceFn& slice, const DriverOptions& opt) {
+	SeqReader reader(opt.reads);
+	ReadChunk all;
+	readChunk(reader, all, SIZE_MAX);
+
+	vector<int> counts;
+	for (int t=1; t<opt.threads; t*=2) counts.push_back(t);
+	counts.push_back(opt.threads);
+
+	cout << "------" << all.seqs.size() << " reads, " << (opt.align ? "align" : opt.count_only ? "count" : "locate") << "------\n";
+	cout << setw(8) << "threads" << setw(16) << "reads/s" << setw(10) << "speedup" << "\n";
+	double base = 0;
+	for (int t : counts) {
+		vector<string> buffers(t);
+		ReadChunk chunk;
+		auto start = chrono::high_resolution_clock::now();
+		for (size_t first=0; first<all.seqs.size(); first+=CHUNK_READS) {
+			size_t last = min(all.seqs.size(), first + CHUNK_READS);
+			chunk.names.assign(all.names.begin() + first, all.names.begin() + last);
+			chunk.seqs.assign(all.seqs.begin() + first, all.seqs.begin() + last);
+			processChunk(slice, chunk, t, buffers);
+		}
+		auto end = chrono::high_resolution_clock::now();
+		double rate = all.seqs.size() / chrono::duration<double>(end - start).count();
+		if (t == 1) base = rate;
+		cout << setw(8) << t << setw(16) << fixed << setprecision(0) << rate
+			 << setw(9) << setprecision(2) << rate / base << "x\n";
+	}
+}
+
+void usage(const char* prog) {
+	cerr << "Usage: " << prog << "                                   (demo)\n"
+		 << "       " << prog << " <reference.fa> <reads.fa|fq> [options]   (multi-FASTA reference)\n"
+		 << "       " << prog << " -x <index> <reads.fa|fq> [options]\n"
+		 << "Options:\n"
+		 << "  -t N     worker threads (default: all cores)\n"
+		 << "  -o FILE  write hits to FILE instead of stdout\n"
+		 << "  -c       count only, skip locating positions\n"
+		 << "  -w FILE  save the built index to FILE\n"
+		 << "  -u FILE  add the contigs of FASTA FILE to the index, merged in\n"
+		 << "           without a rebuild (save the result with -w)\n"
+		 << "  -m MB    build the index on disk within about MB megabytes\n"
+		 << "  -s       report reads/s for 1..N threads instead of writing hits\n"
+		 << "  -a       align reads (seed-and-extend) and write the best alignment\n"
+		 << "           of each; windows come from the index unless the reference\n"
+		 << "           is built in memory\n"
+		 << "  -H       keep the index on 2 MB pages (hugetlb pool, else THP); a\n"
+		 << "           loaded index is copied into memory instead of mapped\n";
+}
+
+int main(int argc, char* argv[]) {
+	if (argc == 1) {
+		runDemo();
+		return 0;
+	}
+
+	DriverOptions opt;
+	vector<string> positional;
+	for (int i=1; i<argc; i++) {
+		string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "-x" && has_value) opt.index = argv[++i];
+		else if (arg == "-t" && has_value) opt.threads = max(1, stoi(argv[++i]));
+		else if (arg == "-o" && has_value) opt.output = argv[++i];
+		else if (arg == "-w" && has_value) opt.save = argv[++i];
+		else if (arg == "-u" && has_value) opt.update = argv[++i];
+		else if (arg == "-m" && has_value) opt.memory_mb = stoul(argv[++i]);
+		else if (arg == "-c") opt.count_only = true;
+		else if (arg == "-s") opt.scaling = true;
+		else if (arg == "-a") opt.align = true;
+		else if (arg == "-H") opt.hugepages = true;
+		else if (!arg.empty() && arg[0] == '-') {
+			usage(argv[0]);
+			return 1;
+		}
+		else positional.push_back(arg);
+	}
+	if (opt.index.empty() && positional.size() == 2) {
+		opt.reference = positional[0];
+		opt.reads = positional[1];
+	} else if (!opt.index.empty() && positional.size() == 1) {
+		opt.reads = positional[0];
+	} else {
+		usage(argv[0]);
+		return 1;
+	}
+
+	try {
+		FMIndex fm;
+		ContigTable contigs;
+		// kept only for alignment when built in memory, otherwise alignment
+		// windows are extracted from the index
+		string text;
+		if (opt.hugepages) setHugePageMode(HugePageMode::Explicit);
+		auto start = chrono::high_resolution_clock::now();
+		if (!opt.index.empty()) {
+			// the contig table follows the index sections in the same file
+			IndexReader in(opt.index, opt.hugepages);
+			fm = FMIndex::load(in);
+			contigs.load(in);
+		} else if (opt.memory_mb > 0) {
+			// stream the reference to a text file next to the spill files
+			string tmp = filesystem::temp_directory_path().string();
+			string text = tmp + "/fmindex-" + to_string(getpid()) + ".txt";
+			try {
+				writeReferenceText(opt.reference, text, contigs);
+				fm = FMIndex::buildExternal(text, opt.memory_mb << 20, tmp);
+			} catch (...) {
+				filesystem::remove(text);
+				throw;
+			}
+			filesystem::remove(text);
+		} else {
+			text = readReference(opt.reference, contigs);
+			fm = FMIndex(text);
+			if (!opt.align) text = string();
+		}
+		auto end = chrono::high_resolution_clock::now();
+		cerr << (opt.index.empty() ? "Built" : "Loaded") << " index of " << contigs.size() << " contigs in "
+			 << chrono::duration<double>(end - start).count() << " seconds\n";
+		if (!opt.update.empty()) {
+			start = chrono::high_resolution_clock::now();
+			ContigTable added;
+			string front = readReference(opt.update, added);
+			// the new contigs go in front of the old text, separated from it
+			front.back() = CONTIG_SEPARATOR;
+			fm.add(front);
+			contigs.prepend(added);
+			if (!text.empty()) text = front + text;
+			end = chrono::high_resolution_clock::now();
+			cerr << "Added " << added.size() << " contigs in "
+				 << chrono::duration<double>(end - start).count() << " seconds\n";
+		}
+		if (!opt.save.empty()) {
+			IndexWriter out(opt.save);
+			fm.save(out);
+			contigs.save(out);
+			out.finish();
+		}
+
+		unique_ptr<ReadMapper> mapper;
+		SliceFn slice;
+		if (opt.align) {
+			mapper = make_unique<ReadMapper>(fm, text, &contigs);
+			slice = [&](const ReadChunk& chunk, size_t first, size_t last, string& out) {
+				alignSlice(*mapper, contigs, chunk, first, last, out);
+			};
+		} else {
+			slice = [&](const ReadChunk& chunk, size_t first, size_t last, string& out) {
+				lookupSlice(fm, contigs, chunk, first, last, opt.count_only, out);
+			};
 		}
+		if (opt.scaling) runScaling(slice, opt);
+		else runLookup(slice, opt);
+	} catch (const exception& e) {
+		cerr << "Error: " << e.what() << endl;
+		return 1;
 	}
-    return 0;
+	return 0;
 }
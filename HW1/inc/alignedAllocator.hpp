@@ -0,0 +1,42 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// cache line size, the alignment of matrix buffers and of every row / column
+constexpr size_t MATRIX_ALIGN = 64;
+
+// allocator handing out MATRIX_ALIGN aligned blocks
+template <typename T>
+struct AlignedAllocator {
+	using value_type = T;
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U>&) { }
+
+	T* allocate(size_t n) {
+		if (n > size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(MATRIX_ALIGN)));
+	}
+	void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(MATRIX_ALIGN)); }
+	// default-initialise rather than value-initialise, so a sized vector of
+	// arithmetic T stays uninitialised until written
+	template <typename U>
+	void construct(U* p) { ::new(static_cast<void*>(p)) U; }
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) { ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U>&) const { return true; }
+};
+
+// n elements padded to whole cache lines, so with this stride every row
+// (column) of a matrix starts on a line of its own
+template <typename T>
+size_t paddedStride(size_t n) {
+	constexpr size_t per_line = sizeof(T) < MATRIX_ALIGN ? MATRIX_ALIGN / sizeof(T) : 1;
+	return (n + per_line - 1) / per_line * per_line;
+}
+
+#endif
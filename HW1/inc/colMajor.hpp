@@ -1,10 +1,13 @@
 #ifndef COLUMN_MAJOR_H
 #define COLUMN_MAJOR_H
 #include <vector>
+#include <algorithm>
 #include <random>
-#include <thread>
-#include <mutex>
 #include <cstddef> 
+#include <type_traits>
+#include "alignedAllocator.hpp"
+#include "matrixInit.hpp"
+#include "gemm.hpp"
 #include "rowMajor.hpp"
 
 template <typename T>
@@ -14,14 +17,16 @@ template <typename T>
 class Column_Major_Matrix {
 public:
 	size_t rows, cols;
-	std::vector<std::vector<T>> all_column;
 
 	// rule of five (six?)
+	// random values from a random_device seed
 	Column_Major_Matrix(size_t r, size_t c);
+	// seed is used by the random modes only
+	Column_Major_Matrix(size_t r, size_t c, MatrixInit init, uint64_t seed = 0);
 	Column_Major_Matrix(const Column_Major_Matrix& other);
 	Column_Major_Matrix<T>& operator=(const Column_Major_Matrix<T>& other);
 	Column_Major_Matrix(Column_Major_Matrix&& other) noexcept;
-	Column_Major_Matrix<T>& operator=(const Column_Major_Matrix&& other) noexcept;
+	Column_Major_Matrix<T>& operator=(Column_Major_Matrix&& other) noexcept;
 	~Column_Major_Matrix() { };
 	
 	// conversion
@@ -32,6 +37,11 @@ public:
 	const std::vector<T> getRow(int row_idx) const;
 	size_t rowSize() const {return rows;}
 	size_t colSize() const {return cols;}
+	// one aligned buffer, element (i, j) at data()[j * stride() + i]; columns
+	// are padded to whole cache lines
+	T* data() {return buffer.data();}
+	const T* data() const {return buffer.data();}
+	size_t stride() const {return ld;}
 
 	// setter function
 	void setColumn(int col_idx, const std::vector<T>& col);
@@ -52,47 +62,51 @@ public:
 	// cout << matrix
 	template <typename U>
 	friend std::ostream& operator<<(std::ostream& os, const Column_Major_Matrix<U>& matrix);
+
+private:
+	size_t ld;
+	std::vector<T, AlignedAllocator<T>> buffer;
 };
 
 template <typename T> 
-Column_Major_Matrix<T>::Column_Major_Matrix(size_t r, size_t c) : rows(r), cols(c), all_column(c, std::vector<T>(r)){ 
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<T> dist(1, 10);
-    for (auto& col : all_column) {
-        std::generate(col.begin(), col.end(), [&]() { return dist(gen); });
-    }
+Column_Major_Matrix<T>::Column_Major_Matrix(size_t r, size_t c) 
+	: Column_Major_Matrix(r, c, MatrixInit::Random, std::random_device()()) { }
+
+template <typename T>
+Column_Major_Matrix<T>::Column_Major_Matrix(size_t r, size_t c, MatrixInit init, uint64_t seed)
+	: rows(r), cols(c), ld(paddedStride<T>(r)), buffer(c * ld) {
+	fillMatrix(data(), cols, rows, ld, init, seed);
 }
 
 template <typename T> 
 Column_Major_Matrix<T>::Column_Major_Matrix(const Column_Major_Matrix& other) 
-	: rows(other.rows), cols(other.cols), all_column(other.all_column) { }
+	: rows(other.rows), cols(other.cols), ld(other.ld), buffer(other.buffer) { }
 
 template <typename T>
 Column_Major_Matrix<T>&  Column_Major_Matrix<T>::operator=(const Column_Major_Matrix<T>& other) {
-	if (*this == other) {
-		rows = other.cols;
+	if (this != &other) {
+		rows = other.rows;
 		cols = other.cols;
-		all_column = other.all_column;
+		ld = other.ld;
+		buffer = other.buffer;
 	}
 	return *this;
 }
 
 template <typename T>
 Column_Major_Matrix<T>::Column_Major_Matrix(Column_Major_Matrix&& other) noexcept 
-	:  rows(other.rows), cols(other.cols), all_column(std::move(other.all_column)) {
+	:  rows(other.rows), cols(other.cols), ld(other.ld), buffer(std::move(other.buffer)) {
 	other.rows = 0;
 	other.cols = 0;
 }
 
 template <typename T>
-Column_Major_Matrix<T>& Column_Major_Matrix<T>::operator=(const Column_Major_Matrix&& other) noexcept{
+Column_Major_Matrix<T>& Column_Major_Matrix<T>::operator=(Column_Major_Matrix&& other) noexcept{
 	if (this != &other) {
-		all_column.clear();
-
-		all_column = std::move(other.all_column);
+		buffer = std::move(other.buffer);
 		rows = other.rows;
 		cols = other.cols;
+		ld = other.ld;
 
 		other.rows = 0;
 		other.cols = 0;
@@ -102,11 +116,13 @@ Column_Major_Matrix<T>& Column_Major_Matrix<T>::operator=(const Column_Major_Mat
 
 template <typename T>
 Column_Major_Matrix<T>::operator Row_Major_Matrix<T>() const {
-	Row_Major_Matrix<T> converted(rows, cols);
+	Row_Major_Matrix<T> converted(rows, cols, MatrixInit::Uninitialized);
+	T* out = converted.data();
+	const size_t out_ld = converted.stride();
 
 	for (size_t j=0; j<cols; j++) {
 		for (size_t i=0; i<rows; i++) {
-			converted(i, j) = all_column[j][i];
+			out[i * out_ld + j] = buffer[j * ld + i];
 		}
 	}
 	return converted;
@@ -114,60 +130,61 @@ Column_Major_Matrix<T>::operator Row_Major_Matrix<T>() const {
 
 template <typename T>
 const std::vector<T> Column_Major_Matrix<T>::getColumn(int col_idx) const {
-    if (col_idx < 0 || col_idx >= cols) {
+    if (col_idx < 0 || static_cast<size_t>(col_idx) >= cols) {
         throw std::out_of_range("Column index out of range");
     }
-	return all_column[col_idx];
+	const T* col = data() + col_idx * ld;
+	return std::vector<T>(col, col + rows);
 }
 
 template <typename T>
 const std::vector<T> Column_Major_Matrix<T>::getRow(int row_idx) const {
-	if (row_idx < 0 || row_idx >= rows) {
+	if (row_idx < 0 || static_cast<size_t>(row_idx) >= rows) {
 		throw std::out_of_range("Row index out of range");
 	}
 	std::vector<T> row(cols);
 	for (size_t col=0; col<cols; col++) {
-		row[col] = all_column[col][row_idx];
+		row[col] = buffer[col * ld + row_idx];
 	}
 	return row;
 }
 
 template <typename T>
 void Column_Major_Matrix<T>::setColumn(int col_idx, const std::vector<T>& col) {
-    if (col_idx < 0 || col_idx >= cols) {
+    if (col_idx < 0 || static_cast<size_t>(col_idx) >= cols) {
         throw std::out_of_range("Column index out of range");
     }else if (col.size() != static_cast<size_t>(rows)) {
 		throw std::invalid_argument("Column size does not match the matrix's row count");
 	}
-	all_column[col_idx] = col;
+	std::copy(col.begin(), col.end(), data() + col_idx * ld);
 }
 
 template <typename T>
 void Column_Major_Matrix<T>::setRow(int row_idx, const std::vector<T>& row) {
-    if (row_idx < 0 || row_idx >= rows) {
+    if (row_idx < 0 || static_cast<size_t>(row_idx) >= rows) {
         throw std::out_of_range("Row index out of range");
     }else if (row.size() != static_cast<size_t>(cols)) {
 		throw std::invalid_argument("Row size does not match the matrix's column count");
 	}
 	for (size_t col=0; col<cols; col++) {
-		all_column[col][row_idx] = row[col];
+		buffer[col * ld + row_idx] = row[col];
 	}
 }
 
 template <typename T>
 T& Column_Major_Matrix<T>::operator()(std::size_t r, std::size_t c) {
-	if (r<0 || r>=rows || c<0 || c>=cols) {
+	if (r>=rows || c>=cols) {
 		throw std::out_of_range("Index out of range");
 	}
-	return all_column[c][r];
+	return buffer[c * ld + r];
 }
 
 template <typename T>
 const T& Column_Major_Matrix<T>::operator()(std::size_t r, std::size_t c) const {
-	if (r<0 || r>=rows || c<0 || c>=cols) {
+	if (r>=rows || c>=cols) {
 		throw std::out_of_range("Index out of range");
 	}
-	return all_column[c][r];	
+	return buffer[c * ld + r];	
 }
 
 template <typename T>
@@ -181,16 +198,8 @@ Column_Major_Matrix<T> Column_Major_Matrix<T>::operator*(const Row_Major_Matrix<
 		throw std::runtime_error("Matrix dimension mismatch for multiplication.");
 	}
 
-	Column_Major_Matrix<T> result(M, P);
-	for (size_t i=0; i<M; i++) {
-		for (size_t j=0; j<P; j++) {
-			T sum = T();
-			for (size_t k=0; k<N; k++) {
-				sum += all_column[k][i] * rhs.all_row[k][j];
-			}
-			result(i, j) = sum;
-		}
-	}
+	Column_Major_Matrix<T> result(M, P, MatrixInit::Uninitialized);
+	gemm<T>(M, P, N, {data(), 1, ld}, {rhs.data(), rhs.stride(), 1}, {result.data(), 1, result.ld});
 	return result;
 }
 
@@ -204,31 +213,9 @@ Column_Major_Matrix<T> Column_Major_Matrix<T>::operator%(const Row_Major_Matrix<
 	if (N != rhs_N) {
 		throw std::runtime_error("Matrix dimension mismatch for multiplication.");
 	}
-	// initial parameter
-	Column_Major_Matrix<T> result(M, P);
-	std::vector<std::thread> threads;
-	const int num_threads = 10;
-	std::mutex mtx;
-	// define a work lambda for thread
-	auto work = [&](const int thread_id) {
-		for (size_t i=thread_id; i<M; i+=num_threads) {
-			for (size_t j=0; j<P; j++) {
-				T sum = T();
-				for (size_t k=0; k<N; k++) {
-					sum += all_column[k][i] * rhs.all_row[k][j];
-				}
-				result(i, j) = sum;
-			}
-		}
-	};
-	// add threads
-	for (int t=0; t<num_threads; t++) {
-		threads.emplace_back(work, t);
-	}
-	// wait threads
-	for (auto& t : threads) {
-		t.join();
-	}
+	// tiles of the result on the shared worker pool
+	Column_Major_Matrix<T> result(M, P, MatrixInit::Uninitialized);
+	gemmParallel<T>(M, P, N, {data(), 1, ld}, {rhs.data(), rhs.stride(), 1}, {result.data(), 1, result.ld});
 	return result;
 }
 
@@ -236,18 +223,14 @@ template <typename T>
 bool Column_Major_Matrix<T>::operator==(const Column_Major_Matrix<T>& other) const {
 	if (rows != other.rows || cols != other.cols) return false;
 	for (size_t j=0; j<cols; j++) {
-		if (all_column[j] != other.all_column[j]) return false;
+		if (!std::equal(data() + j * ld, data() + j * ld + rows, other.data() + j * other.ld)) return false;
 	}
 	return true;
 }
 
 template <typename T>
 bool Column_Major_Matrix<T>::operator==(const Row_Major_Matrix<T>& other) const {
-	if (rows != other.rows || cols != other.cols) return false;
-	for (size_t j=0; j<cols; j++) {
-		if (all_column[j] != other.getColumn(j)) return false;
-	}
-	return true;	
+	return other == *this;
 }
 
 template <typename T>
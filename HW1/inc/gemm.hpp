@@ -0,0 +1,221 @@
+#ifndef GEMM_H
+#define GEMM_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "alignedAllocator.hpp"
+#include "workerPool.hpp"
+
+// strided view of a matrix, element (i, j) at p[i * rs + j * cs]; row-major
+// storage has cs = 1, column-major rs = 1
+template <typename T>
+struct MatrixView {
+	T* p;
+	size_t rs, cs;
+	T& operator()(size_t i, size_t j) const { return p[i * rs + j * cs]; }
+};
+
+// Blocking of the multiply: an MR x NR tile of C stays in registers through
+// the micro-kernel, a KC x NR sliver of B in L1, an MC x KC block of A in L2
+// and the KC x NC panel of B in L3. A kernel type carries its blocking and
+// run(kc, a, b, acc), which sets the MR x NR acc to an A sliver times a B
+// sliver.
+
+namespace gemm_detail {
+
+// SSE-sized vector of T (GCC/Clang vector extension); the compiler lowers
+// it to whatever the target offers, SSE2 on a plain x86-64 build
+template <typename T>
+struct Vec128 {
+	typedef T type __attribute__((vector_size(16)));
+};
+
+template <typename T>
+constexpr bool has_vec128 = (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+	|| std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+// portable kernel for element types without an xsimd kernel: two SSE
+// vectors per row of the tile, 8 accumulators in the 16 SSE registers;
+// types the vector extension does not take run the same loops on scalars
+template <typename T>
+struct VectorKernel {
+	static constexpr size_t MR = 4, NR = sizeof(T) < 8 ? 32 / sizeof(T) : 4;
+	static constexpr size_t KC = 256, MC = 96, NC = 2048;
+
+	static void run(size_t kc, const T* __restrict a, const T* __restrict b, T (&acc)[MR][NR]) {
+		if constexpr (has_vec128<T> && NR % (16 / sizeof(T)) == 0) {
+			using V = typename Vec128<T>::type;
+			constexpr size_t L = sizeof(V) / sizeof(T), NV = NR / L;
+			V c[MR][NV] = {};
+			for (size_t k=0; k<kc; k++) {
+				V bk[NV];
+				std::memcpy(bk, b, sizeof(bk));
+				for (size_t i=0; i<MR; i++) {
+					V ai;
+					for (size_t l=0; l<L; l++) ai[l] = a[i];
+					for (size_t v=0; v<NV; v++) c[i][v] += ai * bk[v];
+				}
+				a += MR;
+				b += NR;
+			}
+			for (size_t i=0; i<MR; i++) {
+				for (size_t v=0; v<NV; v++) std::memcpy(&acc[i][v * L], &c[i][v], sizeof(V));
+			}
+		} else {
+			for (size_t i=0; i<MR; i++) {
+				for (size_t j=0; j<NR; j++) acc[i][j] = T();
+			}
+			for (size_t k=0; k<kc; k++) {
+				for (size_t i=0; i<MR; i++) {
+					for (size_t j=0; j<NR; j++) acc[i][j] += a[i] * b[j];
+				}
+				a += MR;
+				b += NR;
+			}
+		}
+	}
+};
+
+// uninitialised aligned buffer. Not a std::vector: its zero fill would be
+// compiled once per instruction set, and the linker keeps just one copy.
+template <typename T>
+struct PackBuffer {
+	T* p;
+	size_t n;
+	explicit PackBuffer(size_t n) : p(AlignedAllocator<T>().allocate(n)), n(n) { std::uninitialized_default_construct_n(p, n); }
+	~PackBuffer() {
+		std::destroy_n(p, n);
+		AlignedAllocator<T>().deallocate(p, n);
+	}
+	PackBuffer(const PackBuffer&) = delete;
+	PackBuffer& operator=(const PackBuffer&) = delete;
+};
+
+// MR-row slivers of the mc x kc block of A at (ic, pc), k-major inside a
+// sliver; rows past mc are zero. Templated on the kernel, like everything
+// below, so each instruction set's objects keep their own copies.
+template <typename Kernel, typename T>
+void packA(MatrixView<const T> A, size_t ic, size_t pc, size_t mc, size_t kc, T* out) {
+	constexpr size_t MR = Kernel::MR;
+	for (size_t ir=0; ir<mc; ir+=MR) {
+		const size_t m = std::min(MR, mc - ir);
+		for (size_t k=0; k<kc; k++) {
+			for (size_t i=0; i<m; i++) out[i] = A(ic + ir + i, pc + k);
+			for (size_t i=m; i<MR; i++) out[i] = T();
+			out += MR;
+		}
+	}
+}
+
+// NR-column slivers of the kc x nc panel of B at (pc, jc)
+template <typename Kernel, typename T>
+void packB(MatrixView<const T> B, size_t pc, size_t jc, size_t kc, size_t nc, T* out) {
+	constexpr size_t NR = Kernel::NR;
+	for (size_t jr=0; jr<nc; jr+=NR) {
+		const size_t n = std::min(NR, nc - jr);
+		for (size_t k=0; k<kc; k++) {
+			for (size_t j=0; j<n; j++) out[j] = B(pc + k, jc + jr + j);
+			for (size_t j=n; j<NR; j++) out[j] = T();
+			out += NR;
+		}
+	}
+}
+
+// C = A * B with Kernel. Panels of B and blocks of A are packed into
+// contiguous slivers, so the kernel streams both with unit stride whatever
+// the layout.
+template <typename Kernel, typename T>
+void gemmBlocked(size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C) {
+	constexpr size_t MR = Kernel::MR, NR = Kernel::NR;
+	constexpr size_t KC = Kernel::KC, MC = Kernel::MC, NC = Kernel::NC;
+	if (K == 0) {
+		for (size_t i=0; i<M; i++) {
+			for (size_t j=0; j<N; j++) C(i, j) = T();
+		}
+		return;
+	}
+	// blocks are packed in whole slivers, zero-padded past the edge
+	PackBuffer<T> a_pack((MC + MR - 1) / MR * MR * KC), b_pack(KC * ((NC + NR - 1) / NR * NR));
+	T acc[MR][NR];
+	for (size_t jc=0; jc<N; jc+=NC) {
+		const size_t nc = std::min(NC, N - jc);
+		for (size_t pc=0; pc<K; pc+=KC) {
+			const size_t kc = std::min(KC, K - pc);
+			packB<Kernel>(B, pc, jc, kc, nc, b_pack.p);
+			for (size_t ic=0; ic<M; ic+=MC) {
+				const size_t mc = std::min(MC, M - ic);
+				packA<Kernel>(A, ic, pc, mc, kc, a_pack.p);
+				for (size_t jr=0; jr<nc; jr+=NR) {
+					const size_t n = std::min(NR, nc - jr);
+					for (size_t ir=0; ir<mc; ir+=MR) {
+						const size_t m = std::min(MR, mc - ir);
+						Kernel::run(kc, a_pack.p + ir * kc, b_pack.p + jr * kc, acc);
+						// the first K block sets C, later ones add to it
+						for (size_t i=0; i<m; i++) {
+							for (size_t j=0; j<n; j++) {
+								T& c = C(ic + ir + i, jc + jr + j);
+								c = pc == 0 ? acc[i][j] : c + acc[i][j];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// gemmBlocked() with the xsimd kernels of instruction set Arch; defined in
+// gemmKernel.hpp and instantiated by the src/gemm<Arch>.cpp compiled for Arch
+template <class Arch, typename T>
+void gemmArch(Arch, size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C);
+
+template <typename T>
+constexpr bool has_xsimd_kernel = std::is_same_v<T, int16_t> || std::is_same_v<T, int>
+	|| std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+}
+
+// the xsimd kernels of the best instruction set the running CPU has, among
+// SSE2 / SSE4.1 / AVX2+FMA / AVX-512BW (src/gemmDispatch.cpp)
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const int16_t> A, MatrixView<const int16_t> B, MatrixView<int16_t> C);
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C);
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C);
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const double> A, MatrixView<const double> B, MatrixView<double> C);
+
+// C = A * B for an M x K A and a K x N B, any storage order of each
+template <typename T>
+void gemm(size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C) {
+	if constexpr (gemm_detail::has_xsimd_kernel<T>) gemmDispatch(M, N, K, A, B, C);
+	else gemm_detail::gemmBlocked<gemm_detail::VectorKernel<T>>(M, N, K, A, B, C);
+}
+
+// Output tiles of the parallel multiply. 240 rows are two MC blocks and
+// whole micro-tiles for every MR; 512 columns of B at KC deep sit in L2 next
+// to the A block. Tiles halve, down to 60 x 128, until each worker gets
+// about four, so small products still load-balance.
+constexpr size_t GEMM_TILE_M = 240, GEMM_TILE_N = 512;
+constexpr size_t GEMM_MIN_TILE_M = 60, GEMM_MIN_TILE_N = 128;
+
+// gemm() over 2D tiles of C, run as parallel jobs on pool; each tile packs
+// its own blocks of A and B
+template <typename T>
+void gemmParallel(size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C,
+		WorkerPool& pool = defaultWorkerPool()) {
+	size_t tm = GEMM_TILE_M, tn = GEMM_TILE_N;
+	auto tiles = [&]() { return (M + tm - 1) / tm * ((N + tn - 1) / tn); };
+	while (tiles() < 4 * pool.size() && (tm > GEMM_MIN_TILE_M || tn > GEMM_MIN_TILE_N)) {
+		if (tn > GEMM_MIN_TILE_N && (tn >= tm || tm == GEMM_MIN_TILE_M)) tn /= 2;
+		else tm /= 2;
+	}
+	const size_t tiles_n = (N + tn - 1) / tn;
+	pool.parallelFor(tiles(), [&](size_t t) {
+		const size_t i = t / tiles_n * tm, j = t % tiles_n * tn;
+		gemm<T>(std::min(tm, M - i), std::min(tn, N - j), K,
+			{A.p + i * A.rs, A.rs, A.cs}, {B.p + j * B.cs, B.rs, B.cs}, {C.p + i * C.rs + j * C.cs, C.rs, C.cs});
+	});
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef GEMM_KERNEL_H
+#define GEMM_KERNEL_H
+#include <type_traits>
+#include "xsimd/xsimd.hpp"
+#include "gemm.hpp"
+
+// xsimd micro-kernels; only the src/gemm<Arch>.cpp files include this, each
+// compiled with the flags of its instruction set
+
+namespace gemm_detail {
+
+// two batches per row of the tile and as many rows as the register file
+// holds: 4 with the 16 SSE registers, 6 with AVX2 (12 accumulators, 2 B
+// batches and the broadcast A), 12 with the 32 AVX-512 ones
+template <class Arch, typename T>
+struct XsimdKernel {
+	using B = xsimd::batch<T, Arch>;
+	static constexpr size_t L = B::size;
+	static constexpr size_t MR = std::is_base_of_v<xsimd::avx512f, Arch> ? 12 : std::is_base_of_v<xsimd::avx2, Arch> ? 6 : 4;
+	static constexpr size_t NR = 2 * L;
+	static constexpr size_t KC = 256, MC = 120, NC = 3072;
+
+	static void run(size_t kc, const T* __restrict a, const T* __restrict b, T (&acc)[MR][NR]) {
+		B c[MR][2];
+		for (size_t i=0; i<MR; i++) c[i][0] = c[i][1] = B(T());
+		for (size_t k=0; k<kc; k++) {
+			const B b0 = B::load_aligned(b), b1 = B::load_aligned(b + L);
+			for (size_t i=0; i<MR; i++) {
+				const B ai(a[i]);
+				// fused on FMA targets; integer lanes multiply and add,
+				// wrapping in T like the scalar loop
+				c[i][0] = xsimd::fma(ai, b0, c[i][0]);
+				c[i][1] = xsimd::fma(ai, b1, c[i][1]);
+			}
+			a += MR;
+			b += NR;
+		}
+		for (size_t i=0; i<MR; i++) {
+			c[i][0].store_unaligned(&acc[i][0]);
+			c[i][1].store_unaligned(&acc[i][L]);
+		}
+	}
+};
+
+template <class Arch, typename T>
+void gemmArch(Arch, size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C) {
+	gemmBlocked<XsimdKernel<Arch, T>>(M, N, K, A, B, C);
+}
+
+}
+
+// explicit instantiations of gemmArch for instruction set ARCH
+#define GEMM_INSTANTIATE(ARCH) \
+	template void gemm_detail::gemmArch<ARCH, int16_t>(ARCH, size_t, size_t, size_t, MatrixView<const int16_t>, MatrixView<const int16_t>, MatrixView<int16_t>); \
+	template void gemm_detail::gemmArch<ARCH, int>(ARCH, size_t, size_t, size_t, MatrixView<const int>, MatrixView<const int>, MatrixView<int>); \
+	template void gemm_detail::gemmArch<ARCH, float>(ARCH, size_t, size_t, size_t, MatrixView<const float>, MatrixView<const float>, MatrixView<float>); \
+	template void gemm_detail::gemmArch<ARCH, double>(ARCH, size_t, size_t, size_t, MatrixView<const double>, MatrixView<const double>, MatrixView<double>);
+
+#endif
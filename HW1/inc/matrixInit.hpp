@@ -0,0 +1,49 @@
+#ifndef MATRIX_INIT_H
+#define MATRIX_INIT_H
+#include <algorithm>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "workerPool.hpp"
+
+// how a new matrix is filled
+enum class MatrixInit {
+	Uninitialized,	// left as allocated, for results about to be overwritten
+	Zero,
+	Random,			// values from 1 to 10, drawn from the seed
+	ParallelRandom	// same values as Random, filled on the worker pool
+};
+
+// rows (columns) of a random matrix per pool job
+constexpr size_t RANDOM_FILL_LINES = 16;
+
+// fill the first len elements of each of the lines of a buffer with stride
+// ld. Every line draws from its own generator seeded by (seed, line), so
+// the values depend on the seed only, not on the thread count.
+template <typename T>
+void fillMatrix(T* data, size_t lines, size_t len, size_t ld, MatrixInit init, uint64_t seed) {
+	if (init == MatrixInit::Uninitialized) return;
+	if (init == MatrixInit::Zero) {
+		for (size_t l=0; l<lines; l++) std::fill(data + l * ld, data + l * ld + len, T());
+		return;
+	}
+	auto fill = [&](size_t first, size_t last) {
+		std::conditional_t<std::is_integral_v<T>, std::uniform_int_distribution<T>,
+			std::uniform_real_distribution<T>> dist(1, 10);
+		for (size_t l=first; l<last; l++) {
+			std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32), uint32_t(l), uint32_t(uint64_t(l) >> 32)};
+			std::mt19937 gen(seq);
+			std::generate(data + l * ld, data + l * ld + len, [&]() { return dist(gen); });
+		}
+	};
+	if (init == MatrixInit::Random) {
+		fill(0, lines);
+		return;
+	}
+	defaultWorkerPool().parallelFor((lines + RANDOM_FILL_LINES - 1) / RANDOM_FILL_LINES, [&](size_t job) {
+		fill(job * RANDOM_FILL_LINES, std::min(lines, (job + 1) * RANDOM_FILL_LINES));
+	});
+}
+
+#endif
@@ -2,10 +2,13 @@
 #define ROW_MAJOR_MATRIX_H
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <random>
-#include <thread>
-#include <mutex>
 #include <cstddef> 
+#include <type_traits>
+#include "alignedAllocator.hpp"
+#include "matrixInit.hpp"
+#include "gemm.hpp"
 #include "colMajor.hpp"
 
 template <typename T>
@@ -15,14 +18,16 @@ template <typename T>
 class Row_Major_Matrix {
 public:	
 	size_t rows, cols;
-	std::vector<std::vector<T>> all_row;
 
 	// rule of five (six ?)
+	// random values from a random_device seed
 	Row_Major_Matrix(size_t r, size_t c);
+	// seed is used by the random modes only
+	Row_Major_Matrix(size_t r, size_t c, MatrixInit init, uint64_t seed = 0);
 	Row_Major_Matrix(const Row_Major_Matrix& other);
 	Row_Major_Matrix<T>& operator=(const Row_Major_Matrix& other);
 	Row_Major_Matrix(Row_Major_Matrix&& other) noexcept;
-	Row_Major_Matrix<T>& operator=(const Row_Major_Matrix&& other) noexcept;
+	Row_Major_Matrix<T>& operator=(Row_Major_Matrix&& other) noexcept;
 	~Row_Major_Matrix() { };
 
 	// conversion
@@ -33,6 +38,11 @@ public:
 	const std::vector<T> getColumn(int col_idx) const;
 	size_t rowSize() const {return rows;}
 	size_t colSize() const {return cols;}
+	// one aligned buffer, element (i, j) at data()[i * stride() + j]; rows are
+	// padded to whole cache lines
+	T* data() {return buffer.data();}
+	const T* data() const {return buffer.data();}
+	size_t stride() const {return ld;}
 
 	// setter function
 	void setRow(int row_idx, const std::vector<T>& row);
@@ -53,48 +63,52 @@ public:
 	// cout << matrix
 	template <typename U>
 	friend std::ostream& operator<<(std::ostream& os, const Row_Major_Matrix<U>& matrix);
+
+private:
+	size_t ld;
+	std::vector<T, AlignedAllocator<T>> buffer;
 };
 
 
 template <typename T>
-Row_Major_Matrix<T>::Row_Major_Matrix(size_t r, size_t c) : rows(r), cols(c), all_row(r, std::vector<T>(c)) {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<T> dist(1, 10);
-    for (auto& row : all_row) {
-        std::generate(row.begin(), row.end(), [&]() { return dist(gen); });
-    }
+Row_Major_Matrix<T>::Row_Major_Matrix(size_t r, size_t c) 
+	: Row_Major_Matrix(r, c, MatrixInit::Random, std::random_device()()) { }
+
+template <typename T>
+Row_Major_Matrix<T>::Row_Major_Matrix(size_t r, size_t c, MatrixInit init, uint64_t seed)
+	: rows(r), cols(c), ld(paddedStride<T>(c)), buffer(r * ld) {
+	fillMatrix(data(), rows, cols, ld, init, seed);
 }
 
 template <typename T>
 Row_Major_Matrix<T>::Row_Major_Matrix(const Row_Major_Matrix& other) 
-	:rows(other.rows), cols(other.cols), all_row(other.all_row) { }
+	:rows(other.rows), cols(other.cols), ld(other.ld), buffer(other.buffer) { }
 
 template <typename T>
 Row_Major_Matrix<T>& Row_Major_Matrix<T>::operator=(const Row_Major_Matrix& other) {
-	if (&this != other) {
+	if (this != &other) {
 		rows = other.rows;
 		cols = other.cols;
-		all_row = other.all_row;
+		ld = other.ld;
+		buffer = other.buffer;
 	}
 	return *this;
 }
 
 template <typename T>
 Row_Major_Matrix<T>::Row_Major_Matrix(Row_Major_Matrix&& other) noexcept
-	:rows(other.rows), cols(other.cols), all_row(std::move(other.all_row)) {
+	:rows(other.rows), cols(other.cols), ld(other.ld), buffer(std::move(other.buffer)) {
 	other.rows = 0;
 	other.cols = 0;
 }
 
 template <typename T>
-Row_Major_Matrix<T>& Row_Major_Matrix<T>::operator=(const Row_Major_Matrix&& other) noexcept{
+Row_Major_Matrix<T>& Row_Major_Matrix<T>::operator=(Row_Major_Matrix&& other) noexcept{
 	if (this != &other) {
-		all_row.clear();
-
-		all_row = std::move(other.all_row);
+		buffer = std::move(other.buffer);
 		rows = other.rows;
 		cols = other.cols;
+		ld = other.ld;
 
 		other.rows = 0;
 		other.cols = 0;
@@ -104,11 +118,13 @@ Row_Major_Matrix<T>& Row_Major_Matrix<T>::operator=(const Row_Major_Matrix&& oth
 
 template <typename T>
 Row_Major_Matrix<T>::operator Column_Major_Matrix<T>() const {
-	Column_Major_Matrix<T> converted(rows, cols);
+	Column_Major_Matrix<T> converted(rows, cols, MatrixInit::Uninitialized);
+	T* out = converted.data();
+	const size_t out_ld = converted.stride();
 
 	for (size_t i=0; i<rows; i++) {
 		for (size_t j=0; j<cols; j++) {
-			converted(i, j) = all_row[i][j];
+			out[j * out_ld + i] = buffer[i * ld + j];
 		}
 	}
 	return converted;
@@ -116,60 +132,61 @@ Row_Major_Matrix<T>::operator Column_Major_Matrix<T>() const {
 
 template <typename T>
 const std::vector<T> Row_Major_Matrix<T>::getRow(int row_idx) const {
-    if (row_idx < 0 || row_idx >= rows) {
+    if (row_idx < 0 || static_cast<size_t>(row_idx) >= rows) {
         throw std::out_of_range("Row index out of range");
     }
-	return all_row[row_idx];
+	const T* row = data() + row_idx * ld;
+	return std::vector<T>(row, row + cols);
 }
 
 template <typename T>
 const std::vector<T> Row_Major_Matrix<T>::getColumn(int col_idx) const {
-    if (col_idx < 0 || col_idx >= cols) {
+    if (col_idx < 0 || static_cast<size_t>(col_idx) >= cols) {
         throw std::out_of_range("Column index out of range");
     }
 	std::vector<T>col(rows);
 	for (size_t row=0; row<rows; row++) {
-		col[row] = all_row[row][col_idx];
+		col[row] = buffer[row * ld + col_idx];
 	}
 	return col;
 }
 
 template <typename T>
 void Row_Major_Matrix<T>::setRow(int row_idx, const std::vector<T>& row) {
-    if (row_idx < 0 || row_idx >= rows) {
+    if (row_idx < 0 || static_cast<size_t>(row_idx) >= rows) {
         throw std::out_of_range("Row index out of range");
     }else if (row.size() != static_cast<size_t>(cols)) {
 		throw std::invalid_argument("Row size does not match the matrix's column count");
 	}
-	all_row[row_idx] = row;
+	std::copy(row.begin(), row.end(), data() + row_idx * ld);
 }
 
 template <typename T>
 void Row_Major_Matrix<T>::setColumn(int col_idx, const std::vector<T>& col) {
-    if (col_idx < 0 || col_idx >= cols) {
+    if (col_idx < 0 || static_cast<size_t>(col_idx) >= cols) {
         throw std::out_of_range("Column index out of range");
     }else if (col.size() != static_cast<size_t>(rows)) {
 		throw std::invalid_argument("Column size does not match the matrix's row count");
 	}
 	for (size_t row=0; row<rows; row++) {
-		all_row[row][col_idx] = col[row];
+		buffer[row * ld + col_idx] = col[row];
 	}
 }
 
 template <typename T>
 T& Row_Major_Matrix<T>::operator()(std::size_t r, std::size_t c) {
-	if (r<0 || r>=rows || c<0 || c>=cols) {
+	if (r>=rows || c>=cols) {
 		throw std::out_of_range("Index out of range");
 	}
-	return all_row[r][c];
+	return buffer[r * ld + c];
 }
 
 template <typename T>
 const T& Row_Major_Matrix<T>::operator()(std::size_t r, std::size_t c) const {
-	if (r<0 || r>=rows || c<0 || c>=cols) {
+	if (r>=rows || c>=cols) {
 		throw std::out_of_range("Index out of range");
 	}
-	return all_row[r][c];
+	return buffer[r * ld + c];
 }
 
 template <typename T>
@@ -183,16 +200,8 @@ Row_Major_Matrix<T> Row_Major_Matrix<T>::operator*(const Column_Major_Matrix<T>&
 		throw std::runtime_error("Matrix dimension mismatch for multiplication.");
 	}
 
-	Row_Major_Matrix<T> result(M, P);
-	for (size_t i=0; i<M; i++) {
-		for (size_t j=0; j<P; j++) {
-			T sum = T();
-			for (size_t k=0; k<N; k++) {
-				sum += all_row[i][k] * rhs.all_column[k][j];
-			}
-			result(i, j) = sum;
-		}
-	}
+	Row_Major_Matrix<T> result(M, P, MatrixInit::Uninitialized);
+	gemm<T>(M, P, N, {data(), ld, 1}, {rhs.data(), 1, rhs.stride()}, {result.data(), result.ld, 1});
 	return result;
 }
 
@@ -206,31 +215,9 @@ Row_Major_Matrix<T> Row_Major_Matrix<T>::operator%(const Column_Major_Matrix<T>&
 	if (N != rhs_N) {
 		throw std::runtime_error("Matrix dimension mismatch for multiplication.");
 	}
-	// initial parameter
-	Row_Major_Matrix<T> result(M, P);
-	std::vector<std::thread> threads;
-	const int num_threads = 10;
-	std::mutex mtx;
-	// define a work lambda for thread
-	auto work = [&](const int thread_id) {
-		for (size_t i=thread_id; i<M; i+=num_threads) {
-			for (size_t j=0; j<P; j++) {
-				T sum = T();
-				for (size_t k=0; k<N; k++) {
-					sum += all_row[i][k] * rhs.all_column[k][j];
-				}
-				result(i, j) = sum;
-			}
-		}		
-	};
-	// add threads
-	for (int t=0; t<num_threads; t++) {
-		threads.emplace_back(work, t);
-	}
-	// wait threads
-	for (auto& t : threads) {
-		t.join();
-	}
+	// tiles of the result on the shared worker pool
+	Row_Major_Matrix<T> result(M, P, MatrixInit::Uninitialized);
+	gemmParallel<T>(M, P, N, {data(), ld, 1}, {rhs.data(), 1, rhs.stride()}, {result.data(), result.ld, 1});
 	return result;
 }
 
@@ -238,7 +225,7 @@ template <typename T>
 bool Row_Major_Matrix<T>::operator==(const Row_Major_Matrix<T>& other) const {
 	if (rows != other.rows || cols != other.cols) return false;
 	for (size_t i=0; i<rows; i++) {
-		if (all_row[i] != other.all_row[i]) return false;
+		if (!std::equal(data() + i * ld, data() + i * ld + cols, other.data() + i * other.ld)) return false;
 	}
 	return true;
 }
@@ -246,8 +233,12 @@ bool Row_Major_Matrix<T>::operator==(const Row_Major_Matrix<T>& other) const {
 template <typename T>
 bool Row_Major_Matrix<T>::operator==(const Column_Major_Matrix<T>& other) const {
 	if (rows != other.rows || cols != other.cols) return false;
+	const T* o = other.data();
+	const size_t o_ld = other.stride();
 	for (size_t i=0; i<rows; i++) {
-		if (all_row[i] != other.getRow(i)) return false;
+		for (size_t j=0; j<cols; j++) {
+			if (buffer[i * ld + j] != o[j * o_ld + i]) return false;
+		}
 	}
 	return true;
 }
@@ -0,0 +1,45 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// Persistent pool for data-parallel loops. Unlike ThreadPool it takes any
+// number of threads, logs nothing and lets the caller wait for a batch.
+class WorkerPool {
+public:
+	// num_threads counts the calling thread, which works too
+	explicit WorkerPool(size_t num_threads = std::thread::hardware_concurrency());
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	size_t size() const { return workers.size() + 1; }
+	// job(0) .. job(n - 1), spread over the pool; returns once all are done.
+	// Calls from different threads take turns, a job must not call back in.
+	void parallelFor(size_t n, const std::function<void(size_t)>& job);
+
+private:
+	void work();
+	void runJobs();
+
+	std::vector<std::thread> workers;
+	std::mutex run_mtx;
+	std::mutex mtx;
+	std::condition_variable start_cv, done_cv;
+	bool stop;
+	// current batch, changed only while no worker is inside it
+	size_t generation;
+	size_t active;
+	const std::function<void(size_t)>* batch_job;
+	size_t batch_size;
+	std::atomic<size_t> next;
+};
+
+// shared pool with one thread per hardware thread, started on first use
+WorkerPool& defaultWorkerPool();
+
+#endif
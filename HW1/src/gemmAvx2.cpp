@@ -0,0 +1,3 @@
+#include "gemmKernel.hpp"
+
+GEMM_INSTANTIATE(xsimd::fma3<xsimd::avx2>)
@@ -0,0 +1,3 @@
+#include "gemmKernel.hpp"
+
+GEMM_INSTANTIATE(xsimd::avx512bw)
@@ -0,0 +1,40 @@
+#include "gemm.hpp"
+#include "xsimd/xsimd.hpp"
+
+// instruction sets with a kernel object, best first; xsimd picks the first
+// one the running CPU supports
+using GemmArchs = xsimd::arch_list<xsimd::avx512bw, xsimd::fma3<xsimd::avx2>, xsimd::sse4_1, xsimd::sse2>;
+
+namespace {
+
+struct GemmRun {
+	template <class Arch, typename T>
+	void operator()(Arch arch, size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C) {
+		gemm_detail::gemmArch<Arch, T>(arch, M, N, K, A, B, C);
+	}
+};
+
+template <typename T>
+void run(size_t M, size_t N, size_t K, MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C) {
+	// the dispatcher looks the CPU up once and caches the choice
+	static auto dispatched = xsimd::dispatch<GemmArchs>(GemmRun{});
+	dispatched(M, N, K, A, B, C);
+}
+
+}
+
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const int16_t> A, MatrixView<const int16_t> B, MatrixView<int16_t> C) {
+	run(M, N, K, A, B, C);
+}
+
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C) {
+	run(M, N, K, A, B, C);
+}
+
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C) {
+	run(M, N, K, A, B, C);
+}
+
+void gemmDispatch(size_t M, size_t N, size_t K, MatrixView<const double> A, MatrixView<const double> B, MatrixView<double> C) {
+	run(M, N, K, A, B, C);
+}
@@ -22,8 +22,9 @@ int main() {
 
     /* test overload % */
 	int size = 1000;  // set matrix size
-    Row_Major_Matrix<int> A(size, size);
-    Column_Major_Matrix<int> B(size, size);
+    // fixed seeds, so every run multiplies the same matrices
+    Row_Major_Matrix<int> A(size, size, MatrixInit::ParallelRandom, 1);
+    Column_Major_Matrix<int> B(size, size, MatrixInit::ParallelRandom, 2);
 
     /* Row major x  Column major */
     cout << "------Row major x Column major------\n";
@@ -0,0 +1,70 @@
+#include "workerPool.hpp"
+
+WorkerPool::WorkerPool(size_t num_threads)
+	: stop(false), generation(0), active(0), batch_job(nullptr), batch_size(0), next(0) {
+	// hardware_concurrency() is 0 when unknown
+	for (size_t t=1; t<num_threads; t++) {
+		workers.emplace_back([this] { work(); });
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	// scope of mutex lock
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stop = true;
+	}
+	start_cv.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+// claim job indices until the batch runs out
+void WorkerPool::runJobs() {
+	for (size_t i = next.fetch_add(1); i < batch_size; i = next.fetch_add(1)) (*batch_job)(i);
+}
+
+void WorkerPool::work() {
+	size_t seen = 0;
+	while (true) {
+		// scope of mutex lock
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			start_cv.wait(lock, [&] { return stop || generation != seen; });
+			if (stop) break;
+			seen = generation;
+			active++;
+		}
+		runJobs();
+		std::lock_guard<std::mutex> lock(mtx);
+		if (--active == 0) done_cv.notify_one();
+	}
+}
+
+void WorkerPool::parallelFor(size_t n, const std::function<void(size_t)>& job) {
+	if (n == 0) return;
+	if (workers.empty() || n == 1) {
+		for (size_t i=0; i<n; i++) job(i);
+		return;
+	}
+	std::lock_guard<std::mutex> turn(run_mtx);
+	// scope of mutex lock
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		// a worker waking late may still be in the last batch
+		done_cv.wait(lock, [this] { return active == 0; });
+		batch_job = &job;
+		batch_size = n;
+		next = 0;
+		generation++;
+	}
+	start_cv.notify_all();
+	runJobs();
+	// every index is claimed, wait for the workers still running one
+	std::unique_lock<std::mutex> lock(mtx);
+	done_cv.wait(lock, [this] { return active == 0; });
+}
+
+WorkerPool& defaultWorkerPool() {
+	static WorkerPool pool;
+	return pool;
+}